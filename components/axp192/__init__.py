@@ -0,0 +1,65 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome import automation
+from esphome.components import i2c
+from esphome.const import CONF_ID, CONF_DURATION
+
+CONF_AXP192_ID = "axp192_id"
+
+axp192_ns = cg.esphome_ns.namespace('axp192')
+AXP192Component = axp192_ns.class_('AXP192Component', cg.PollingComponent, i2c.I2CDevice)
+AXP192Event = axp192_ns.enum("AXP192Event")
+AXP192Rail = axp192_ns.enum("AXP192Rail")
+
+CONF_RAIL = "rail"
+
+# Rail, voltage range and step in V, mirrors AXP192_RAILS
+RAILS = {
+    "DCDC1": (AXP192Rail.RAIL_DCDC1, 0.7, 3.5, 0.025),
+    "DCDC2": (AXP192Rail.RAIL_DCDC2, 0.7, 2.275, 0.025),
+    "DCDC3": (AXP192Rail.RAIL_DCDC3, 0.7, 3.5, 0.025),
+    "LDO2": (AXP192Rail.RAIL_LDO2, 1.8, 3.3, 0.1),
+    "LDO3": (AXP192Rail.RAIL_LDO3, 1.8, 3.3, 0.1),
+    "LDOIO0": (AXP192Rail.RAIL_LDOIO0, 1.8, 3.3, 0.1),
+}
+validate_rail = cv.one_of(*RAILS, upper=True)
+
+CONF_PROFILE = "profile"
+
+DeepSleepAction = axp192_ns.class_("DeepSleepAction", automation.Action)
+LightSleepAction = axp192_ns.class_("LightSleepAction", automation.Action)
+DumpHistoryAction = axp192_ns.class_("DumpHistoryAction", automation.Action)
+DumpTraceAction = axp192_ns.class_("DumpTraceAction", automation.Action)
+
+# Without a duration only the wake sources of the profile end the sleep
+SLEEP_ACTION_SCHEMA = cv.Schema({
+    cv.GenerateID(): cv.use_id(AXP192Component),
+    cv.Optional(CONF_DURATION): cv.templatable(cv.positive_time_period_milliseconds),
+    # Name of one of the sleep_profiles, the model default when omitted
+    cv.Optional(CONF_PROFILE): cv.string_strict,
+})
+
+
+@automation.register_action("axp192.deep_sleep", DeepSleepAction, SLEEP_ACTION_SCHEMA)
+@automation.register_action("axp192.light_sleep", LightSleepAction, SLEEP_ACTION_SCHEMA)
+def sleep_action_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    yield cg.register_parented(var, config[CONF_ID])
+    if CONF_DURATION in config:
+        template_ = yield cg.templatable(config[CONF_DURATION], args, cg.uint32)
+        cg.add(var.set_duration(template_))
+    if CONF_PROFILE in config:
+        cg.add(var.set_profile(config[CONF_PROFILE]))
+    yield var
+
+
+@automation.register_action("axp192.dump_history", DumpHistoryAction, cv.Schema({
+    cv.GenerateID(): cv.use_id(AXP192Component),
+}))
+@automation.register_action("axp192.dump_trace", DumpTraceAction, cv.Schema({
+    cv.GenerateID(): cv.use_id(AXP192Component),
+}))
+def dump_action_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    yield cg.register_parented(var, config[CONF_ID])
+    yield var
@@ -0,0 +1,85 @@
+#ifndef __AXP192_AUTOMATION_H__
+#define __AXP192_AUTOMATION_H__
+
+#include "esphome/core/automation.h"
+#include "axp192.h"
+
+namespace esphome
+{
+    namespace axp192
+    {
+
+        class AXP192EventTrigger : public Trigger<>
+        {
+        public:
+            AXP192EventTrigger(AXP192Component *parent, AXP192Event event)
+            {
+                parent->add_on_event_callback(event, [this]() { this->trigger(); });
+            }
+        };
+
+        class AXP192LowBatteryShutdownTrigger : public Trigger<>
+        {
+        public:
+            explicit AXP192LowBatteryShutdownTrigger(AXP192Component *parent)
+            {
+                parent->add_on_low_battery_shutdown_callback([this]() { this->trigger(); });
+            }
+        };
+
+        template <typename... Ts>
+        class DeepSleepAction : public Action<Ts...>, public Parented<AXP192Component>
+        {
+        public:
+            TEMPLATABLE_VALUE(uint32_t, duration)
+
+            void set_profile(const char *profile) { this->profile_ = profile; }
+
+            void play(Ts... x) override
+            {
+                uint64_t duration = this->duration_.has_value() ? this->duration_.value(x...) * 1000ULL : 0;
+                const AXP192SleepProfile *profile = this->profile_ != nullptr ? this->parent_->find_sleep_profile(this->profile_) : nullptr;
+                this->parent_->DeepSleep(duration, profile);
+            }
+
+        protected:
+            const char *profile_{nullptr};
+        };
+
+        template <typename... Ts>
+        class LightSleepAction : public Action<Ts...>, public Parented<AXP192Component>
+        {
+        public:
+            TEMPLATABLE_VALUE(uint32_t, duration)
+
+            void set_profile(const char *profile) { this->profile_ = profile; }
+
+            void play(Ts... x) override
+            {
+                uint64_t duration = this->duration_.has_value() ? this->duration_.value(x...) * 1000ULL : 0;
+                const AXP192SleepProfile *profile = this->profile_ != nullptr ? this->parent_->find_sleep_profile(this->profile_) : nullptr;
+                this->parent_->LightSleep(duration, profile);
+            }
+
+        protected:
+            const char *profile_{nullptr};
+        };
+
+        template <typename... Ts>
+        class DumpHistoryAction : public Action<Ts...>, public Parented<AXP192Component>
+        {
+        public:
+            void play(Ts... x) override { this->parent_->DumpHistory(); }
+        };
+
+        template <typename... Ts>
+        class DumpTraceAction : public Action<Ts...>, public Parented<AXP192Component>
+        {
+        public:
+            void play(Ts... x) override { this->parent_->DumpTrace(); }
+        };
+
+    }
+}
+
+#endif
@@ -1,525 +1,2370 @@
 #include "axp192.h"
 #include "esphome/core/log.h"
+#include "esphome/core/application.h"
 #include "esp_sleep.h"
 #include "esp_log.h"
 #include "esp_system.h"
+#include "esp_attr.h"
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
 
 namespace esphome
 {
     namespace axp192
     {
         static const char *TAG = "axp192.sensor";
+
+        // Control registers only this component writes to; reads of these are served from reg_cache_
+        static const uint8_t AXP192_CACHED_REGISTERS[] = {
+            0x12, 0x23, 0x26, 0x27, 0x28, 0x30, 0x31, 0x32, 0x33, 0x35, 0x36, 0x39, 0x82, 0x83, 0x84, 0x90, 0x91};
+        static_assert(sizeof(AXP192_CACHED_REGISTERS) == AXP192_CACHED_REGISTER_COUNT, "cache size mismatch");
+
+        // IRQ status bits behind each event, laid out as 0x44..0x47 from most to least significant byte
+        static const uint32_t AXP192_EVENT_IRQ_BITS[EVENT_COUNT] = {
+            (1UL << 1) << 8,             // EVENT_BUTTON_SHORT_PRESS: 0x46 bit 1
+            (1UL << 0) << 8,             // EVENT_BUTTON_LONG_PRESS: 0x46 bit 0
+            (1UL << 3) << 24,            // EVENT_VBUS_INSERT: 0x44 bit 3
+            (1UL << 2) << 24,            // EVENT_VBUS_REMOVE: 0x44 bit 2
+            (1UL << 1) | (1UL << 0),     // EVENT_LOW_BATTERY: 0x47 warning level 1 and 2
+            (1UL << 3) << 16,            // EVENT_CHARGE_START: 0x45 bit 3
+            (1UL << 2) << 16,            // EVENT_CHARGE_DONE: 0x45 bit 2
+        };
+
+        static const char *const AXP192_CHANNEL_NAMES[CHANNEL_COUNT] = {
+            "Battery Voltage", "Battery Current", "VBUS Voltage", "VBUS Current", "VIN Current", "Temperature"};
+        static const uint16_t AXP192_CHANNEL_ADC[CHANNEL_COUNT] = {
+            ADC_BAT_VOLTAGE, ADC_BAT_CURRENT, ADC_VBUS_VOLTAGE, ADC_VBUS_CURRENT, ADC_VIN_CURRENT, ADC_TEMPERATURE};
+        static const AXP192Quantity AXP192_CHANNEL_QUANTITY[CHANNEL_COUNT] = {
+            QUANTITY_BAT_VOLTAGE, QUANTITY_BAT_CURRENT, QUANTITY_VBUS_VOLTAGE,
+            QUANTITY_VBUS_CURRENT, QUANTITY_VIN_CURRENT, QUANTITY_TEMPERATURE};
+
+        static constexpr AXP192AdcDescriptor AXP192_ADC_DESCRIPTORS[QUANTITY_COUNT] = {
+            {0x56, 12, 0, 17, 10, 0},       // QUANTITY_VIN_VOLTAGE: 1.7mV
+            {0x58, 12, 0, 5, 8, 0},         // QUANTITY_VIN_CURRENT: 0.625mA
+            {0x5A, 12, 0, 17, 10, 0},       // QUANTITY_VBUS_VOLTAGE: 1.7mV
+            {0x5C, 12, 0, 3, 8, 0},         // QUANTITY_VBUS_CURRENT: 0.375mA
+            {0x5E, 12, 0, 100, 1, -144700}, // QUANTITY_TEMPERATURE: 0.1°C from -144.7°C
+            {0x62, 12, 0, 4, 5, 0},         // QUANTITY_TS_VOLTAGE: 0.8mV
+            {0x78, 12, 0, 11, 10, 0},       // QUANTITY_BAT_VOLTAGE: 1.1mV
+            {0x7A, 13, 0, 1, 2, 0},         // QUANTITY_BAT_CHARGE_CURRENT: 0.5mA
+            {0x7C, 13, 0, 1, 2, 0},         // QUANTITY_BAT_DISCHARGE_CURRENT: 0.5mA
+            {0x7A, 13, 0x7C, 1, 2, 0},      // QUANTITY_BAT_CURRENT: charge minus discharge
+            {0x7E, 12, 0, 14, 10, 0},       // QUANTITY_APS_VOLTAGE: 1.4mV
+        };
+
+        // Raw result from its two registers: 8 high bits, then 4 (12 bit) or 5 (13 bit) low bits
+        static constexpr int32_t AXP192RawAdc(const uint8_t *result, uint8_t bits)
+        {
+            return bits == 13 ? (result[0] << 5) | (result[1] & 0x1F) : (result[0] << 4) | (result[1] & 0x0F);
+        }
+
+        // Raw result to milli-units, rounded to nearest
+        static constexpr int32_t AXP192ScaleMilli(const AXP192AdcDescriptor &d, int32_t raw)
+        {
+            return (2 * raw * d.lsb_num + (raw < 0 ? -d.lsb_den : d.lsb_den)) / (2 * d.lsb_den) + d.offset;
+        }
+
+        static constexpr uint8_t AXP192_RAW_ALL_ONES[2] = {0xFF, 0xFF};
+        static_assert(AXP192RawAdc(AXP192_RAW_ALL_ONES, 12) == 0x0FFF, "12 bit results keep 4 low bits");
+        static_assert(AXP192RawAdc(AXP192_RAW_ALL_ONES, 13) == 0x1FFF, "13 bit results keep 5 low bits");
+        static_assert(AXP192ScaleMilli(AXP192_ADC_DESCRIPTORS[QUANTITY_BAT_VOLTAGE], 3818) == 4200, "battery voltage");
+        static_assert(AXP192ScaleMilli(AXP192_ADC_DESCRIPTORS[QUANTITY_TEMPERATURE], 1447) == 0, "temperature offset");
+        static_assert(AXP192ScaleMilli(AXP192_ADC_DESCRIPTORS[QUANTITY_BAT_CURRENT], -3) == -2, "negative rounding");
+        static_assert(AXP192ScaleMilli(AXP192_ADC_DESCRIPTORS[QUANTITY_VBUS_CURRENT], 8) == 3, "fractional LSB");
+
+        // Fuel gauge state kept in RTC memory so it survives deep sleep and soft resets
+        struct AXP192FuelGaugeRtc
+        {
+            uint32_t magic;
+            float charge_mah;
+            int64_t ref_counts;
+            uint8_t adc_rate;
+        };
+        static const uint32_t AXP192_FUEL_GAUGE_MAGIC = 0xA1920C01;
+        static RTC_NOINIT_ATTR AXP192FuelGaugeRtc fuel_gauge_rtc;
+
+        // Energy totals kept in RTC memory between flash commits, so deep sleep cycles cost no flash writes
+        struct AXP192EnergyRtc
+        {
+            uint32_t magic;
+            AXP192EnergyRecord record;
+            uint32_t uncommitted_ms;
+        };
+        static const uint32_t AXP192_ENERGY_MAGIC = 0xA192E001;
+        static RTC_NOINIT_ATTR AXP192EnergyRtc energy_rtc;
+
+        static const AXP192RailDescriptor AXP192_RAILS[RAIL_COUNT] = {
+            {"DCDC1", 0x12, (1 << 0), (1 << 0), 0, 0x26, 0x7F, 0, 700, 25, 3500},
+            {"DCDC2", 0x12, (1 << 4), (1 << 4), 0, 0x23, 0x3F, 0, 700, 25, 2275},
+            {"DCDC3", 0x12, (1 << 1), (1 << 1), 0, 0x27, 0x7F, 0, 700, 25, 3500},
+            {"LDO2", 0x12, (1 << 2), (1 << 2), 0, 0x28, 0xF0, 4, 1800, 100, 3300},
+            {"LDO3", 0x12, (1 << 3), (1 << 3), 0, 0x28, 0x0F, 0, 1800, 100, 3300},
+            // GPIO0 in LDO mode, floating when off
+            {"LDOio0", 0x90, 0x07, 0x02, 0x07, 0x91, 0xF0, 4, 1800, 100, 3300},
+        };
+
+        static const char *const AXP192_ENERGY_NAMES[ENERGY_COUNT] = {
+            "Battery Charge Energy", "Battery Discharge Energy", "VBUS Energy", "VIN Energy"};
+
+        // 0x33 charge current codes in mA
+        static const uint16_t AXP192_CHARGE_CURRENT_MA[] = {100, 190, 280, 360, 450, 550, 630, 700};
+        // Time the charger gets to settle after a raise before the next one
+        static const uint32_t AXP192_CHARGE_SETTLE_MS = 10000;
+        // VBUS voltage and PMIC temperature must clear their limits by this much before raising
+        static const int32_t AXP192_CHARGE_VBUS_MARGIN_MV = 100;
+        static const int32_t AXP192_CHARGE_TEMP_MARGIN_MC = 5000;
+
+#ifdef AXP192_HISTORY_BLOCKS
+        // History ring in RTC slow memory; survives deep sleep and soft resets, not power loss
+        struct AXP192HistoryRtc
+        {
+            uint32_t magic;
+            uint16_t head;
+            uint8_t blocks[AXP192_HISTORY_BLOCKS][AXP192_HISTORY_BLOCK_SIZE];
+        };
+        static const uint32_t AXP192_HISTORY_RTC_MAGIC = 0xA1921157;
+        static RTC_NOINIT_ATTR AXP192HistoryRtc history_rtc;
+#endif
+
+        // Registers SetSleep() changes, the only ones a deep sleep wake has to put back
+        static const uint8_t AXP192_SLEEP_REGISTERS[] = {0x12, 0x31, 0x33, 0x82, 0x83, 0x90};
+        static const uint8_t AXP192_SLEEP_REGISTER_COUNT = sizeof(AXP192_SLEEP_REGISTERS);
+        // IRQ enable registers a sleep profile can replace
+        static const uint8_t AXP192_IRQ_ENABLE_REGISTERS[] = {0x40, 0x41, 0x42, 0x43, 0x4A};
+        static const uint8_t AXP192_IRQ_ENABLE_REGISTER_COUNT = sizeof(AXP192_IRQ_ENABLE_REGISTERS);
+
+        // Register state left behind by DeepSleep(), so the wake can skip begin()
+        struct AXP192WakeRtc
+        {
+            uint32_t magic;
+            uint32_t signature;
+            uint32_t cache_valid;
+            uint8_t cache[AXP192_CACHED_REGISTER_COUNT];
+            uint8_t slept[AXP192_SLEEP_REGISTER_COUNT];
+            // IRQ enables from before a profile with an irq_mask, put back on any wake; valid when irq_magic is set
+            uint32_t irq_magic;
+            uint8_t irq_enables[AXP192_IRQ_ENABLE_REGISTER_COUNT];
+        };
+        static const uint32_t AXP192_WAKE_MAGIC = 0xA1920D5E;
+        static RTC_NOINIT_ATTR AXP192WakeRtc wake_rtc;
+
+        // RTC slow memory is 8 kB on the ESP32 and shared with ESPHome, ESP-IDF and any ULP program; keep to half
+        static const size_t AXP192_RTC_BUDGET = 4096;
+#ifdef AXP192_HISTORY_BLOCKS
+        static const size_t AXP192_HISTORY_RTC_SIZE = sizeof(AXP192HistoryRtc);
+#else
+        static const size_t AXP192_HISTORY_RTC_SIZE = 0;
+#endif
+        static_assert(sizeof(AXP192FuelGaugeRtc) + sizeof(AXP192EnergyRtc) + sizeof(AXP192WakeRtc) + AXP192_HISTORY_RTC_SIZE <=
+                          AXP192_RTC_BUDGET,
+                      "RTC memory state exceeds its budget, configure fewer history blocks");
+
+        static const char *const AXP192_RESET_REASONS[] = {
+            "ESP_RST_UNKNOWN", "ESP_RST_POWERON", "ESP_RST_EXT", "ESP_RST_SW", "ESP_RST_PANIC", "ESP_RST_INT_WDT",
+            "ESP_RST_TASK_WDT", "ESP_RST_WDT", "ESP_RST_DEEPSLEEP", "ESP_RST_BROWNOUT", "ESP_RST_SDIO"};
+        static const char *const AXP192_WAKEUP_REASONS[] = {
+            "WAKEUP_UNKNOWN_REASON", "WAKEUP_UNKNOWN_REASON", "ESP_SLEEP_WAKEUP_EXT0", "ESP_SLEEP_WAKEUP_EXT1",
+            "ESP_SLEEP_WAKEUP_TIMER", "ESP_SLEEP_WAKEUP_TOUCHPAD", "ESP_SLEEP_WAKEUP_ULP", "ESP_SLEEP_WAKEUP_GPIO",
+            "ESP_SLEEP_WAKEUP_UART"};
+
+        // Used when no profile is given: everything but DCDC1 off, no ADCs, the model wake pins
+        static const AXP192SleepProfile AXP192_DEFAULT_SLEEP_PROFILE = {
+            "default", 0, 0, ModelTraits::SLEEP_WAKE_PINS, false, false, -1, -1};
+
+        // CIE 1931 luminance for perceived lightness 0/16 .. 16/16, scaled to 255
+        static const uint8_t AXP192_BACKLIGHT_CURVE[17] = {
+            0, 2, 4, 7, 11, 17, 25, 35, 47, 62, 79, 99, 123, 150, 181, 216, 255};
+
+        // Resting LiPo open-circuit voltage in mV at 0%, 5%, ... 100% state of charge
+        static const uint16_t AXP192_OCV_TABLE[] = {
+            3270, 3610, 3690, 3710, 3730, 3750, 3770, 3790, 3800, 3820, 3840,
+            3850, 3870, 3910, 3950, 3980, 4020, 4080, 4110, 4150, 4200};
+        static const uint8_t AXP192_OCV_STEPS = sizeof(AXP192_OCV_TABLE) / sizeof(AXP192_OCV_TABLE[0]) - 1;
+
+        // Battery current below this (mA) for AXP192_REST_TIME ms counts as rest, when the voltage is close to OCV
+        static const float AXP192_REST_CURRENT = 10.0f;
+        static const uint32_t AXP192_REST_TIME = 5 * 60 * 1000;
+        // Fraction of the OCV error corrected per update while resting
+        static const float AXP192_OCV_WEIGHT = 0.25f;
+        // 0x3A/0x3B threshold code: 2.8672V plus 5.6mV per step
+        static uint8_t AXP192ApsWarningCode(int32_t mv)
+        {
+            return clamp<int32_t>((mv * 10 - 28672 + 28) / 56, 0, 255);
+        }
+        // Marker in the PMIC data buffer (0x06), followed by the last shutdown latency in ms (0x07..0x08)
+        static const uint8_t AXP192_SHUTDOWN_MARKER = 0xA1;
+
+        // Time constant of the battery current average behind time_to_empty and time_to_full
+        static const float AXP192_RUNTIME_TAU_MS = 10 * 60 * 1000.0f;
+
         void AXP192Component::setup()
         {
-            ESP_LOGD(TAG, "setup(): Model %d", this->model_);
-            ESP_LOGD(TAG, "setup(): Charge current %d", this->charge_current_);
+            ESP_LOGV(TAG, "setup(): Model %s", ModelTraits::NAME);
+            ESP_LOGV(TAG, "setup(): Charge current %d", this->charge_current_);
 
-            switch (this->model_)
+            if (this->fast_sample_interval_ > 0)
             {
-            case AXP192_M5STICKC:
+                // Run the ADC at least as fast as we sample so every sample is a fresh conversion. Settled before
+                // begin() writes 0x84 and before the fuel gauge compares it with the rate its counts were taken at
+                uint8_t rate = ADC_RATE_25HZ;
+                while (rate < ADC_RATE_200HZ && 1000u / (25u << rate) > this->fast_sample_interval_)
+                    rate++;
+                RegisterAdcChannels(0, static_cast<AXP192AdcRate>(rate));
+            }
+
+            esp_reset_reason_t reset_reason = ::esp_reset_reason();
+            uint8_t rails_before = 0;
+            ReadByte(0x12, &rails_before);
+            if (reset_reason == ESP_RST_DEEPSLEEP && wake_rtc.irq_magic == AXP192_WAKE_MAGIC)
             {
-                begin(false, false, false, false, false);
-                break;
+                // The sleep profile replaced the IRQ enables, put them back whichever way the wake goes
+                BeginWriteBatch();
+                WriteIrqEnables(wake_rtc.irq_enables);
+                FlushWriteBatch();
             }
-            case AXP192_M5CORE2:
+            wake_rtc.irq_magic = 0;
+            this->fast_wake_ = reset_reason == ESP_RST_DEEPSLEEP && RestoreFromSleep();
+            wake_rtc.magic = 0;
+            if (!this->fast_wake_)
             {
-                // disable LDO3 Vibration
-                begin(false, true, false, false, false);
-                break;
+                begin();
+            }
+
+            // Setup runs at IO priority, ahead of the displays and sensors on these rails. On a cold boot the
+            // voltages move from the OTP defaults, after a sleep rails come back up; give them time to settle.
+            // can_proceed() holds the components after this one back meanwhile, the main loop keeps running
+            uint8_t rails_after = 0;
+            ReadByte(0x12, &rails_after);
+            if (reset_reason == ESP_RST_POWERON || (rails_after & ~rails_before))
+            {
+                this->set_timeout("rails", ModelTraits::RAIL_SETTLE_MS, [this]() {
+                    this->rails_settled_ = true;
+                    ESP_LOGD(TAG, "Rails up %u ms after boot", (unsigned) millis());
+                });
             }
-            case AXP192_M5TOUGH:
+            else
             {
-                begin(false, false, false, false, false);
+                this->rails_settled_ = true;
+                ESP_LOGD(TAG, "Rails up %u ms after boot", (unsigned) millis());
+            }
 
-                // If we're waking from a cold boot
-                if (GetStartupReason() == "ESP_RST_POWERON")
-                {
-                    ESP_LOGD(TAG, "First power on, restarting ESP...");
+            // Initial state for the event driven binary sensors, 0x00 bit 5 is VBUS present and 0x01 bit 6 charging
+#ifdef USE_BINARY_SENSOR
+            // A failed read leaves the sensor without a state until its next event
+            uint8_t status;
+            if (this->vbus_binary_sensor_ != nullptr && ReadByte(0x00, &status))
+                this->vbus_binary_sensor_->publish_state(status & (1 << 5));
+            if (this->charging_binary_sensor_ != nullptr && ReadByte(0x01, &status))
+                this->charging_binary_sensor_->publish_state(status & (1 << 6));
+            if (this->lowbattery_binary_sensor_ != nullptr)
+                this->lowbattery_binary_sensor_->publish_state(false);
+            if (this->button_binary_sensor_ != nullptr)
+                this->button_binary_sensor_->publish_state(false);
+#endif
+
+            this->backlight_ready_ = true;
+            UpdateBrightness();
 
-                    // Reboot the ESP with the axp initialised
-                    esp_restart();
-                }
-                break;
+            if (this->adc_duty_cycle_)
+            {
+                // Converting stays off until the first update powers the ADCs for its read
+                SetAdcState(false);
+            }
+
+            if (this->battery_capacity_ > 0.0f)
+            {
+                SetupFuelGauge();
             }
-            case AXP192_TTGO_TCALL:
+
+            if (EnergyUsed())
             {
-                // disable LDO2, LDO3, RTC and DCDC1
-                begin(true, true, true, true, false);
-                break;
+                SetupEnergy();
             }
-	    case AXP192_LILYGO_TCAMINI:
-	    {
-                begin(false, false, false, false, false);
-                break;
+
+            for (uint8_t i = 0; i < CHANNEL_COUNT; i++)
+            {
+                this->channel_next_[i] = millis();
+            }
+
+            if (this->fast_sample_interval_ > 0)
+            {
+                this->set_interval("fast_sample", this->fast_sample_interval_, [this]() { SampleChannels(); });
+            }
+
+            if (this->irq_pin_ != nullptr)
+            {
+                // The IRQ output is open drain and active low
+                this->irq_pin_->setup();
+                this->irq_pin_->attach_interrupt(AXP192Component::gpio_intr, this, gpio::INTERRUPT_FALLING_EDGE);
+            }
+
+            if (this->shutdown_enabled_)
+            {
+                ReportLastShutdown();
+                if (this->irq_pin_ == nullptr)
+                {
+                    // No IRQ line, the update interval is far too slow to catch a collapsing battery
+                    this->set_interval("low_battery", this->shutdown_poll_interval_, [this]() { ServiceIrq(); });
+                }
             }
-	    }
         }
 
         void AXP192Component::dump_config()
         {
             ESP_LOGCONFIG(TAG, "AXP192:");
+            ESP_LOGCONFIG(TAG, "  Model: %s", ModelTraits::NAME);
             LOG_I2C_DEVICE(this);
+            ESP_LOGCONFIG(TAG, "  Startup reason: %s%s", GetStartupReason(), this->fast_wake_ ? " (fast wake)" : "");
+            LOG_PIN("  IRQ Pin: ", this->irq_pin_);
+            ESP_LOGCONFIG(TAG, "  IRQ enable mask: 0x%08X", (unsigned) this->irq_enable_mask_);
             if (this->batterylevel_sensor_ != nullptr)
             {
                 LOG_SENSOR("  ", "Battery Level", this->batterylevel_sensor_);
             }
-            if (this->batteryvoltage_sensor_ != nullptr)
+            if (this->battery_capacity_ > 0.0f)
+            {
+                ESP_LOGCONFIG(TAG, "  Battery capacity: %.0f mAh (coulomb counter)", this->battery_capacity_);
+            }
+            if (this->time_to_empty_sensor_ != nullptr)
+            {
+                LOG_SENSOR("  ", "Time To Empty", this->time_to_empty_sensor_);
+            }
+            if (this->time_to_full_sensor_ != nullptr)
+            {
+                LOG_SENSOR("  ", "Time To Full", this->time_to_full_sensor_);
+            }
+            for (uint8_t i = 0; i < CHANNEL_COUNT; i++)
+            {
+                if (this->channel_sensors_[i] != nullptr)
+                {
+                    LOG_SENSOR("  ", AXP192_CHANNEL_NAMES[i], this->channel_sensors_[i]);
+                }
+                if (this->channel_interval_[i] != 0)
+                {
+                    ESP_LOGCONFIG(TAG, "    Update interval: %u ms", (unsigned) this->channel_interval_[i]);
+                }
+                if (this->channel_min_sensors_[i] != nullptr)
+                {
+                    LOG_SENSOR("    ", "Min", this->channel_min_sensors_[i]);
+                }
+                if (this->channel_max_sensors_[i] != nullptr)
+                {
+                    LOG_SENSOR("    ", "Max", this->channel_max_sensors_[i]);
+                }
+            }
+            ESP_LOGCONFIG(TAG, "  Loop budget: %u us", (unsigned) this->loop_budget_);
+            LogI2CStats();
+            if (this->i2c_transactions_sensor_ != nullptr)
+            {
+                LOG_SENSOR("  ", "I2C Transactions", this->i2c_transactions_sensor_);
+            }
+            if (this->i2c_failures_sensor_ != nullptr)
+            {
+                LOG_SENSOR("  ", "I2C Failures", this->i2c_failures_sensor_);
+            }
+            if (this->i2c_retries_sensor_ != nullptr)
+            {
+                LOG_SENSOR("  ", "I2C Retries", this->i2c_retries_sensor_);
+            }
+            if (this->i2c_latency_sensor_ != nullptr)
             {
-                LOG_SENSOR("  ", "Battery Voltage", this->batteryvoltage_sensor_);
+                LOG_SENSOR("  ", "I2C Max Latency", this->i2c_latency_sensor_);
             }
-            if (this->batterycurrent_sensor_ != nullptr)
+            if (this->loop_time_sensor_ != nullptr)
             {
-                LOG_SENSOR("  ", "Battery Current", this->batterycurrent_sensor_);
+                LOG_SENSOR("  ", "Max Loop Time", this->loop_time_sensor_);
+            }
+            if (this->fast_sample_interval_ > 0)
+            {
+                ESP_LOGCONFIG(TAG, "  Fast sample interval: %u ms", (unsigned) this->fast_sample_interval_);
+            }
+            if (this->adc_duty_cycle_)
+            {
+                ESP_LOGCONFIG(TAG, "  ADC duty cycle: settle %u ms, idle channels 0x%04X", (unsigned) AdcSettleTime(),
+                              (unsigned) AdcIdleChannels());
+            }
+            for (uint8_t i = 0; i < ENERGY_COUNT; i++)
+            {
+                if (this->energy_sensors_[i] != nullptr)
+                {
+                    LOG_SENSOR("  ", AXP192_ENERGY_NAMES[i], this->energy_sensors_[i]);
+                }
             }
-            if (this->vbusvoltage_sensor_ != nullptr)
+            if (this->charge_controller_)
             {
-                LOG_SENSOR("  ", "VBUS Voltage", this->vbusvoltage_sensor_);
+                ESP_LOGCONFIG(TAG, "  Charge controller: up to %u mA, VBUS <= %d mA, >= %d mV, PMIC <= %d C",
+                              (unsigned) AXP192_CHARGE_CURRENT_MA[this->charge_ceiling_], (int) this->charge_vbus_limit_ma_,
+                              (int) this->charge_vbus_min_mv_, (int) (this->charge_max_temp_mc_ / 1000));
             }
-            if (this->vbuscurrent_sensor_ != nullptr)
+            if (EnergyUsed())
             {
-                LOG_SENSOR("  ", "VBUS Current", this->vbuscurrent_sensor_);
+                ESP_LOGCONFIG(TAG, "  Energy commit interval: %u s", (unsigned) (this->energy_commit_interval_ / 1000));
             }
-            if (this->vincurrent_sensor_ != nullptr)
+            if (this->shutdown_enabled_)
             {
-                LOG_SENSOR("  ", "VIN Current", this->vincurrent_sensor_);
+                ESP_LOGCONFIG(TAG, "  Low battery: warning %d mV, shutdown %d mV, then %s within %u ms",
+                              (int) this->shutdown_warning_mv_, (int) this->shutdown_mv_,
+                              this->shutdown_deep_sleep_ ? "deep sleep" : "power off", (unsigned) this->shutdown_deadline_);
             }
-            if (this->temperature_sensor_ != nullptr)
+        }
+
+        void AXP192Component::on_shutdown()
+        {
+            if (EnergyUsed() && this->energy_uncommitted_ms_ > 0)
             {
-                LOG_SENSOR("  ", "Temperature", this->temperature_sensor_);
+                CommitEnergy();
+                global_preferences->sync();
             }
         }
 
-        float AXP192Component::get_setup_priority() const { return setup_priority::DATA; }
+        float AXP192Component::get_setup_priority() const { return setup_priority::IO; }
 
         void AXP192Component::update()
         {
-            ESP_LOGD(TAG, "update()");
+            if (this->update_state_ != UPDATE_IDLE)
+            {
+                ESP_LOGW(TAG, "update(): previous acquisition still running, skipping");
+                return;
+            }
 
-            float vbat = GetBatVoltage();
+            ESP_LOGV(TAG, "update()");
 
-            if (this->batterylevel_sensor_ != nullptr)
+            // Channels without their own interval are published here
+            this->update_due_ = 0;
+            for (uint8_t i = 0; i < CHANNEL_COUNT; i++)
             {
-                float batterylevel = 100.0 * ((vbat - 3.0) / (4.2 - 3.0));
+                if (ChannelUsed(i) && this->channel_interval_[i] == 0)
+                    this->update_due_ |= (1 << i);
+            }
+            this->update_channel_ = 0;
+
+            // The acquisition itself runs from loop(), a few steps per slice
+            this->update_state_ = this->adc_duty_cycle_ ? UPDATE_ADC_WAKE : UPDATE_READ;
+        }
 
-                ESP_LOGD(TAG, "Got Battery Level=%f (%f)", batterylevel, vbat);
-                if (batterylevel > 100.0)
+        bool AXP192Component::StepUpdate()
+        {
+            switch (this->update_state_)
+            {
+            case UPDATE_ADC_WAKE:
+                SetAdcState(true);
+                this->adc_wake_time_ = millis();
+                this->update_state_ = UPDATE_ADC_SETTLE;
+                break;
+            case UPDATE_ADC_SETTLE:
+                // Results are stale until every enabled channel has converted again, yield until then
+                if (millis() - this->adc_wake_time_ < AdcSettleTime())
+                {
+                    return false;
+                }
+                this->update_state_ = UPDATE_READ;
+                break;
+            case UPDATE_READ:
+            {
+                // One burst read covering everything this poll decodes
+                uint8_t read = this->update_due_;
+                if (this->batterylevel_sensor_ != nullptr)
+                    read |= (1 << CHANNEL_BAT_VOLTAGE) | (this->fuel_gauge_ready_ ? (1 << CHANNEL_BAT_CURRENT) : 0);
+                if (EnergyUsed())
+                {
+                    // Energy needs the VIN, VBUS and battery results, 0x56..0x7D covers every channel as well
+                    ReadAdcRange(AXP192_ADC_BLOCK_START, 0x7D);
+                }
+                else
+                {
+                    ReadChannelSpan(read | InternalChannels());
+                }
+                if (this->adc_duty_cycle_)
+                {
+                    // Everything after this decodes from the snapshot
+                    SetAdcState(false);
+                }
+                this->update_state_ = UPDATE_BATTERY_LEVEL;
+                break;
+            }
+            case UPDATE_BATTERY_LEVEL:
+                PublishBatteryLevel();
+                this->update_state_ = UPDATE_RUNTIME;
+                break;
+            case UPDATE_RUNTIME:
+                if (RuntimeUsed())
+                {
+                    UpdateRuntime();
+                }
+                this->update_state_ = UPDATE_ENERGY;
+                break;
+            case UPDATE_ENERGY:
+                if (EnergyUsed())
+                {
+                    UpdateEnergy();
+                }
+                this->update_state_ = UPDATE_CHARGE;
+                break;
+            case UPDATE_CHARGE:
+                if (this->charge_controller_ && this->fast_sample_interval_ == 0)
+                {
+                    ControlChargeCurrent();
+                }
+                this->update_state_ = UPDATE_HISTORY;
+                break;
+            case UPDATE_HISTORY:
+                if (this->history_interval_ > 0 && (!this->history_logged_ || millis() - this->history_last_ >= this->history_interval_))
                 {
-                    batterylevel = 100.0;
+                    LogHistorySample();
                 }
-                else if (batterylevel < 0.0)
+                this->update_state_ = UPDATE_PUBLISH;
+                break;
+            case UPDATE_PUBLISH:
+                // One channel per step, publish callbacks can be slow
+                while (this->update_channel_ < CHANNEL_COUNT && !(this->update_due_ & (1 << this->update_channel_)))
+                    this->update_channel_++;
+                if (this->update_channel_ < CHANNEL_COUNT)
+                {
+                    PublishChannels(1 << this->update_channel_);
+                    this->update_channel_++;
+                    break;
+                }
+                ReleaseAdcBlock();
+                this->update_state_ = UPDATE_IRQ;
+                break;
+            case UPDATE_IRQ:
+                // Without an IRQ line events are picked up here; with one this catches any missed edge
+                if (this->irq_enable_mask_ != 0)
                 {
-                    batterylevel = 0.0;
+                    ServiceIrq();
                 }
-                this->batterylevel_sensor_->publish_state(batterylevel);
+                this->update_state_ = UPDATE_DIAGNOSTICS;
+                break;
+            case UPDATE_DIAGNOSTICS:
+                PublishDiagnostics();
+                this->update_state_ = UPDATE_IDLE;
+                break;
+            default:
+                this->update_state_ = UPDATE_IDLE;
+                break;
             }
-            if (this->batteryvoltage_sensor_ != nullptr)
+            return this->update_state_ != UPDATE_IDLE;
+        }
+
+        void AXP192Component::PublishDiagnostics()
+        {
+            if (!this->first_update_logged_)
             {
-                ESP_LOGD(TAG, "Got Battery Voltage=%f", vbat);
-                this->batteryvoltage_sensor_->publish_state(vbat);
+                // Boot-to-first-publish, the number that matters for nodes waking from deep sleep
+                ESP_LOGI(TAG, "First update published %u ms after boot (%s init)", (unsigned) millis(),
+                         this->fast_wake_ ? "fast wake" : "full");
+                this->first_update_logged_ = true;
             }
-            if (this->batterycurrent_sensor_ != nullptr)
+            if (this->loop_time_sensor_ != nullptr)
             {
-                float cbat = GetBatCurrent();
-                if (cbat != 0.0)
-                {
-                    cbat = cbat / 1000;
-                }
-                ESP_LOGD(TAG, "Got Battery Current=%f", cbat);
-                this->batterycurrent_sensor_->publish_state(cbat);
+                this->loop_time_sensor_->publish_state(this->loop_time_max_ / 1000.0f);
+                this->loop_time_max_ = 0;
             }
-            if (this->vbusvoltage_sensor_ != nullptr)
+            if (this->i2c_transactions_sensor_ != nullptr)
+                this->i2c_transactions_sensor_->publish_state(this->i2c_stats_.transactions);
+            if (this->i2c_failures_sensor_ != nullptr)
+                this->i2c_failures_sensor_->publish_state(this->i2c_stats_.failures);
+            if (this->i2c_retries_sensor_ != nullptr)
+                this->i2c_retries_sensor_->publish_state(this->i2c_stats_.retries);
+            if (this->i2c_latency_sensor_ != nullptr)
             {
-                float vbus_v = GetVBusVoltage();
-                ESP_LOGD(TAG, "Got VBUS Voltage=%f", vbus_v);
-                this->vbusvoltage_sensor_->publish_state(vbus_v);
+                this->i2c_latency_sensor_->publish_state(this->i2c_stats_.latency_max / 1000.0f);
+                this->i2c_stats_.latency_max = 0;
             }
-            if (this->vbuscurrent_sensor_ != nullptr)
+            if (this->i2c_stats_.failures == this->i2c_failures_reported_)
             {
-                float vbus_c = GetVBusCurrent();
-                if (vbus_c != 0.0)
+                this->status_clear_warning();
+            }
+            this->i2c_failures_reported_ = this->i2c_stats_.failures;
+        }
+
+        void AXP192Component::LogI2CStats()
+        {
+            ESP_LOGCONFIG(TAG, "  I2C: %u transactions, %u failures, %u retries", (unsigned) this->i2c_stats_.transactions,
+                          (unsigned) this->i2c_stats_.failures, (unsigned) this->i2c_stats_.retries);
+            uint32_t limit = AXP192_LATENCY_BUCKET_US;
+            for (uint8_t i = 0; i < AXP192_LATENCY_BUCKETS; i++, limit <<= 1)
+            {
+                if (i < AXP192_LATENCY_BUCKETS - 1)
+                    ESP_LOGCONFIG(TAG, "    < %5u us: %u", (unsigned) limit, (unsigned) this->i2c_stats_.latency_histogram[i]);
+                else
+                    ESP_LOGCONFIG(TAG, "    >=%5u us: %u", (unsigned) (limit >> 1), (unsigned) this->i2c_stats_.latency_histogram[i]);
+            }
+        }
+
+        void AXP192Component::PublishBatteryLevel()
+        {
+            if (this->batterylevel_sensor_ == nullptr)
+            {
+                return;
+            }
+
+            float vbat = GetBatVoltage();
+            float batterylevel;
+            if (this->fuel_gauge_ready_)
+            {
+                batterylevel = UpdateFuelGauge(vbat, GetBatCurrent());
+            }
+            else
+            {
+                batterylevel = 100.0 * ((vbat - 3.0) / (4.2 - 3.0));
+            }
+
+            ESP_LOGV(TAG, "Got Battery Level=%f (%f)", batterylevel, vbat);
+            if (batterylevel > 100.0)
+            {
+                batterylevel = 100.0;
+            }
+            else if (batterylevel < 0.0)
+            {
+                batterylevel = 0.0;
+            }
+            this->batterylevel_sensor_->publish_state(batterylevel);
+        }
+
+        bool AXP192Component::ChannelUsed(uint8_t channel)
+        {
+            return this->channel_sensors_[channel] != nullptr || this->channel_min_sensors_[channel] != nullptr ||
+                   this->channel_max_sensors_[channel] != nullptr;
+        }
+
+        float AXP192Component::ReadChannel(uint8_t channel)
+        {
+            // Volts, amperes and degrees Celsius
+            return ReadQuantity(AXP192_CHANNEL_QUANTITY[channel], 0.001f);
+        }
+
+        bool AXP192Component::DecodeQuantity(AXP192Quantity quantity, int32_t *milli)
+        {
+            const AXP192AdcDescriptor &d = AXP192_ADC_DESCRIPTORS[quantity];
+            uint8_t last = std::max(d.reg, d.minus_reg) + 1;
+            const uint8_t *result = &adc_block_[d.reg - AXP192_ADC_BLOCK_START];
+            uint8_t one_off[4]; // QUANTITY_BAT_CURRENT, 0x7A..0x7D, is the widest
+            if (d.reg < adc_block_first_ || last > adc_block_last_)
+            {
+                // A one-off read gets its own buffer, so a snapshot held by a running update stays intact
+                if (!ReadBytes(d.reg, one_off, last - d.reg + 1))
                 {
-                    vbus_c = vbus_c / 1000;
+                    return false;
                 }
-                ESP_LOGD(TAG, "Got VBUS Current=%f", vbus_c);
-                this->vbuscurrent_sensor_->publish_state(vbus_c);
+                result = one_off;
+            }
+
+            int32_t raw = AXP192RawAdc(result, d.bits);
+            if (d.minus_reg != 0)
+            {
+                raw -= AXP192RawAdc(result + (d.minus_reg - d.reg), d.bits);
             }
-            if (this->vincurrent_sensor_ != nullptr)
+            AXP192_TRACE(TRACE_DECODE, quantity, static_cast<uint16_t>(raw));
+            *milli = AXP192ScaleMilli(d, raw);
+            return true;
+        }
+
+        float AXP192Component::ReadQuantity(AXP192Quantity quantity, float scale)
+        {
+            int32_t milli;
+            if (!DecodeQuantity(quantity, &milli))
+                return NAN;
+            return milli * scale;
+        }
+
+        bool AXP192Component::ReadChannelSpan(uint8_t mask)
+        {
+            uint8_t first = AXP192_ADC_BLOCK_END;
+            uint8_t last = AXP192_ADC_BLOCK_START;
+            for (uint8_t i = 0; i < CHANNEL_COUNT; i++)
             {
-                float vin_c = GetVinCurrent();
-                if (vin_c != 0.0)
+                if (mask & (1 << i))
                 {
-                    vin_c = vin_c / 1000;
+                    const AXP192AdcDescriptor &d = AXP192_ADC_DESCRIPTORS[AXP192_CHANNEL_QUANTITY[i]];
+                    first = std::min(first, d.reg);
+                    last = std::max(last, static_cast<uint8_t>(std::max(d.reg, d.minus_reg) + 1));
                 }
-                ESP_LOGD(TAG, "Got VIN Current=%f", vin_c);
-                this->vincurrent_sensor_->publish_state(vin_c);
             }
-            if (this->temperature_sensor_ != nullptr)
+            if (first > last)
             {
-                float temp = GetTempInAXP192();
-                ESP_LOGD(TAG, "Got Temperature=%f", temp);
-                this->temperature_sensor_->publish_state(temp);
+                return true;
             }
+            return ReadAdcRange(first, last);
+        }
 
-            UpdateBrightness();
+        void AXP192Component::PublishChannels(uint8_t mask)
+        {
+            // Channels without fast samples need a reading now, fetched in one transfer
+            uint8_t read = 0;
+            for (uint8_t i = 0; i < CHANNEL_COUNT; i++)
+            {
+                if ((mask & (1 << i)) && this->channel_stats_[i].count == 0)
+                    read |= (1 << i);
+            }
+            bool read_ok = ReadChannelSpan(read);
+
+            for (uint8_t i = 0; i < CHANNEL_COUNT; i++)
+            {
+                if (!(mask & (1 << i)))
+                {
+                    continue;
+                }
+
+                AXP192Aggregate &stats = this->channel_stats_[i];
+                if (stats.count == 0)
+                {
+                    // A failed read publishes NaN rather than a stale or garbage value
+                    stats.add(read_ok ? ReadChannel(i) : NAN);
+                }
+
+                ESP_LOGV(TAG, "Got %s=%f (min %f, max %f, %u samples)", AXP192_CHANNEL_NAMES[i],
+                         stats.mean(), stats.min, stats.max, (unsigned) stats.count);
+                AXP192_TRACE_BEGIN(trace_start);
+                if (this->channel_sensors_[i] != nullptr)
+                    this->channel_sensors_[i]->publish_state(stats.mean());
+                if (this->channel_min_sensors_[i] != nullptr)
+                    this->channel_min_sensors_[i]->publish_state(stats.min);
+                if (this->channel_max_sensors_[i] != nullptr)
+                    this->channel_max_sensors_[i]->publish_state(stats.max);
+                AXP192_TRACE(TRACE_PUBLISH, i, AXP192TraceSince(trace_start));
+                stats.reset();
+            }
         }
 
-        void AXP192Component::begin(bool disableLDO2, bool disableLDO3, bool disableRTC, bool disableDCDC1, bool disableDCDC3)
+        void AXP192Component::SampleChannels()
         {
-            switch (this->model_)
+            if (this->update_state_ != UPDATE_IDLE)
             {
-            case AXP192_M5STICKC:
+                // The update in progress reads fresh results and must keep its snapshot, skip this sample
+                return;
+            }
+            uint8_t mask = 0;
+            for (uint8_t i = 0; i < CHANNEL_COUNT; i++)
             {
-                // Set LDO2 & LDO3(TFT_LED & TFT) 3.0V
-                Write1Byte(0x28, 0xcc);
-                break;
+                if (ChannelUsed(i))
+                    mask |= (1 << i);
+            }
+
+            // One burst read per sample, decoded into the running aggregates
+            if (!ReadChannelSpan(mask | InternalChannels()))
+            {
+                return;
             }
-            case AXP192_M5CORE2:
+            for (uint8_t i = 0; i < CHANNEL_COUNT; i++)
             {
-                // Set DCDC3 (TFT_LED & TFT) 3.0V
-                Write1Byte(0x27, 0xcc);
-                // Set LDO2 & LDO3(TFT_LED & TFT) 3.0V
-                Write1Byte(0x28, 0xcc);
-                break;
+                if (mask & (1 << i))
+                {
+                    this->channel_stats_[i].add(ReadChannel(i));
+                }
             }
-            case AXP192_M5TOUGH:
+            if (this->charge_controller_)
             {
-                // Set DCDC3 (TFT_LED & TFT) 3.0V
-                Write1Byte(0x27, 0xcc);
-                // Set LDO2 & LDO3(TFT_LED & TFT) 3.0V
-                Write1Byte(0x28, 0xcc);
-                break;
+                // Backing off on a sag shouldn't wait for the next update
+                ControlChargeCurrent();
             }
-            case AXP192_TTGO_TCALL:
+            ReleaseAdcBlock();
+        }
+
+        void AXP192Component::loop()
+        {
+            uint32_t start = micros();
+
+            if (this->irq_pending_)
             {
-                break;
+                this->irq_pending_ = false;
+                ServiceIrq(this->irq_edge_us_);
             }
-            case AXP192_LILYGO_TCAMINI:
+
+            // Channels with their own interval; everything due on this tick shares one read. While an update holds
+            // the ADC snapshot they wait for it to finish, their read would replace it
+            uint32_t now = millis();
+            uint8_t due = 0;
+            for (uint8_t i = 0; i < CHANNEL_COUNT && this->update_state_ == UPDATE_IDLE; i++)
             {
-                break;
+                if (this->channel_interval_[i] == 0 || !ChannelUsed(i) || (int32_t)(now - this->channel_next_[i]) < 0)
+                    continue;
+                due |= (1 << i);
+                this->channel_next_[i] += this->channel_interval_[i];
+                if ((int32_t)(now - this->channel_next_[i]) >= 0)
+                {
+                    // Fell behind, don't try to catch up
+                    this->channel_next_[i] = now + this->channel_interval_[i];
+                }
             }
+            if (due != 0)
+            {
+                PublishChannels(due);
+                ReleaseAdcBlock();
             }
 
-            // Depending on configuration enable LDO2, LDO3, DCDC1, DCDC3.
-            uint8_t buf = (Read8bit(0x12) & 0xef) | 0x4D;
-            if (disableLDO3)
-                buf &= ~(1 << 3);
-            if (disableLDO2)
-                buf &= ~(1 << 2);
-            if (disableDCDC3)
-                buf &= ~(1 << 1);
-            if (disableDCDC1)
-                buf &= ~(1 << 0);
-            Write1Byte(0x12, buf);
+            if (this->history_dump_next_ >= 0)
+            {
+                DumpHistoryBlock();
+            }
+#ifdef AXP192_TRACE_RECORDS
+            if (this->trace_dump_next_ >= 0)
+            {
+                DumpTraceChunk();
+            }
+#endif
 
-            if (!disableRTC)
+            // Advance a pending acquisition until this slice's budget is spent, at least one step per loop
+            while (this->update_state_ != UPDATE_IDLE)
             {
-                // Set RTC voltage to 3.3V
-                Write1Byte(0x91, 0xF0);
+#ifdef AXP192_TRACE_RECORDS
+                AXP192UpdateState step = this->update_state_;
+                uint32_t step_start = micros();
+                bool more = StepUpdate();
+                if (this->update_state_ != step)
+                {
+                    // A step that only waited, like the ADC settle, is not worth a record
+                    Trace(TRACE_STEP, step, AXP192TraceSince(step_start));
+                }
+#else
+                bool more = StepUpdate();
+#endif
+                if (!more || micros() - start >= this->loop_budget_)
+                    break;
+            }
 
-                // Set GPIO0 to LDO
-                Write1Byte(0x90, 0x02);
+            uint32_t elapsed = micros() - start;
+            if (elapsed > this->loop_time_max_)
+            {
+                this->loop_time_max_ = elapsed;
             }
+        }
 
-            // Set ADC sample rate to 200hz
-            Write1Byte(0x84, 0b11110010);
+        void IRAM_ATTR AXP192Component::gpio_intr(AXP192Component *arg)
+        {
+            arg->irq_edge_us_ = micros() | 1;
+            arg->irq_pending_ = true;
+        }
 
-            // Set ADC to All Enable
-            Write1Byte(0x82, 0xff);
+        void AXP192Component::ServiceIrq(uint32_t edge_us)
+        {
+            uint8_t status[4];
+            if (!ReadBytes(0x44, status, sizeof(status)))
+            {
+                return;
+            }
 
-            // Set temperature protection
-            Write1Byte(0x39, 0xfc);
+            uint32_t irq = ((uint32_t)status[0] << 24) | ((uint32_t)status[1] << 16) | ((uint32_t)status[2] << 8) | status[3];
+            if (irq == 0)
+            {
+                return;
+            }
 
-            if ( this->model_ != AXP192_TTGO_TCALL)
+            // Writing 1 acknowledges a status bit; all four go out in one multi-write
+            BeginWriteBatch();
+            for (uint8_t i = 0; i < sizeof(status); i++)
             {
-                // Bat charge voltage to 4.2, Current 100MA
-                Write1Byte(0x33, 0xc0);
+                if (status[i] != 0)
+                {
+                    Write1Byte(0x44 + i, status[i]);
+                }
+            }
+            FlushWriteBatch();
 
-                // 128ms power on, 4s power off
-                Write1Byte(0x36, 0x0C);
+            ESP_LOGV(TAG, "IRQ status 0x%08X", (unsigned) irq);
+            if (this->shutdown_enabled_ && (irq & AXP192_IRQ_APS_SHUTDOWN))
+            {
+                // Ahead of the event callbacks, they can wait
+                EmergencyShutdown(edge_us != 0 ? edge_us : micros());
+            }
+            for (uint8_t event = 0; event < EVENT_COUNT; event++)
+            {
+                if (irq & AXP192_EVENT_IRQ_BITS[event])
+                {
+                    HandleEvent(static_cast<AXP192Event>(event));
+                }
+            }
+        }
 
-                // Disable vbus hold limit
+        void AXP192Component::HandleEvent(AXP192Event event)
+        {
+#ifdef USE_BINARY_SENSOR
+            switch (event)
+            {
+            case EVENT_BUTTON_SHORT_PRESS:
+            case EVENT_BUTTON_LONG_PRESS:
+                if (this->button_binary_sensor_ != nullptr)
+                {
+                    // The PEK only reports completed presses, so publish a pulse
+                    this->button_binary_sensor_->publish_state(true);
+                    this->button_binary_sensor_->publish_state(false);
+                }
+                break;
+            case EVENT_VBUS_INSERT:
+                if (this->vbus_binary_sensor_ != nullptr)
+                    this->vbus_binary_sensor_->publish_state(true);
+                if (this->lowbattery_binary_sensor_ != nullptr)
+                    this->lowbattery_binary_sensor_->publish_state(false);
+                break;
+            case EVENT_VBUS_REMOVE:
+                if (this->vbus_binary_sensor_ != nullptr)
+                    this->vbus_binary_sensor_->publish_state(false);
+                if (this->charging_binary_sensor_ != nullptr)
+                    this->charging_binary_sensor_->publish_state(false);
+                break;
+            case EVENT_LOW_BATTERY:
+                if (this->lowbattery_binary_sensor_ != nullptr)
+                    this->lowbattery_binary_sensor_->publish_state(true);
+                break;
+            case EVENT_CHARGE_START:
+                if (this->charging_binary_sensor_ != nullptr)
+                    this->charging_binary_sensor_->publish_state(true);
+                break;
+            case EVENT_CHARGE_DONE:
+                if (this->charging_binary_sensor_ != nullptr)
+                    this->charging_binary_sensor_->publish_state(false);
+                break;
+            default:
+                break;
+            }
+#endif
+            this->event_callback_.call(event);
+        }
+
+        void AXP192Component::add_on_event_callback(AXP192Event event, std::function<void()> &&callback)
+        {
+            this->irq_enable_mask_ |= AXP192_EVENT_IRQ_BITS[event];
+            this->event_callback_.add([event, callback](AXP192Event fired) {
+                if (fired == event)
+                    callback();
+            });
+        }
+
+#ifdef USE_BINARY_SENSOR
+        void AXP192Component::set_vbus_binary_sensor(binary_sensor::BinarySensor *vbus_binary_sensor)
+        {
+            vbus_binary_sensor_ = vbus_binary_sensor;
+            irq_enable_mask_ |= AXP192_EVENT_IRQ_BITS[EVENT_VBUS_INSERT] | AXP192_EVENT_IRQ_BITS[EVENT_VBUS_REMOVE];
+        }
+
+        void AXP192Component::set_charging_binary_sensor(binary_sensor::BinarySensor *charging_binary_sensor)
+        {
+            charging_binary_sensor_ = charging_binary_sensor;
+            irq_enable_mask_ |= AXP192_EVENT_IRQ_BITS[EVENT_CHARGE_START] | AXP192_EVENT_IRQ_BITS[EVENT_CHARGE_DONE] |
+                                AXP192_EVENT_IRQ_BITS[EVENT_VBUS_REMOVE];
+        }
+
+        void AXP192Component::set_lowbattery_binary_sensor(binary_sensor::BinarySensor *lowbattery_binary_sensor)
+        {
+            lowbattery_binary_sensor_ = lowbattery_binary_sensor;
+            irq_enable_mask_ |= AXP192_EVENT_IRQ_BITS[EVENT_LOW_BATTERY] | AXP192_EVENT_IRQ_BITS[EVENT_VBUS_INSERT];
+        }
+
+        void AXP192Component::set_button_binary_sensor(binary_sensor::BinarySensor *button_binary_sensor)
+        {
+            button_binary_sensor_ = button_binary_sensor;
+            irq_enable_mask_ |= AXP192_EVENT_IRQ_BITS[EVENT_BUTTON_SHORT_PRESS] | AXP192_EVENT_IRQ_BITS[EVENT_BUTTON_LONG_PRESS];
+        }
+#endif
+
+        void AXP192Component::begin()
+        {
+            BeginWriteBatch();
+
+            if (ModelTraits::SET_DCDC3_VOLTAGE)
+            {
+                // Set DCDC3 (TFT_LED & TFT) 3.0V
+                Write1Byte(0x27, 0xcc);
+            }
+            if (ModelTraits::SET_LDO23_VOLTAGE)
+            {
+                // Set LDO2 & LDO3(TFT_LED & TFT) 3.0V
+                Write1Byte(0x28, 0xcc);
+            }
+
+            // Depending on the model enable LDO2, LDO3, DCDC1, DCDC3.
+            // Reading 0x12 here fills the cache, later rail changes only cost a write.
+            uint8_t buf;
+            if (ReadByte(0x12, &buf))
+            {
+                uint8_t rails = ((buf & 0xef) | 0x4D) & ~ModelTraits::DISABLED_RAILS;
+                if (this->brightness_ > 0)
+                {
+                    // The backlight comes up with the other rails rather than one write later
+                    rails |= ModelTraits::BACKLIGHT_RAIL;
+                }
+                Write1Byte(0x12, rails);
+            }
+            else
+            {
+                ESP_LOGE(TAG, "Could not read the power output control register, rails left unchanged");
+            }
+
+            if (!ModelTraits::DISABLE_RTC)
+            {
+                // Set RTC voltage to 3.3V
+                Write1Byte(0x91, 0xF0);
+
+                // Set GPIO0 to LDO
+                Write1Byte(0x90, 0x02);
+            }
+
+            // Only convert the channels something reads
+            adc_channels_ |= ConfiguredAdcChannels();
+            adc_configured_ = true;
+            WriteAdcConfig();
+
+            // Set temperature protection
+            Write1Byte(0x39, 0xfc);
+
+            if (this->shutdown_enabled_)
+            {
+                // APS low voltage levels: 1 is the warning, 2 starts the emergency shutdown
+                Write1Byte(0x3A, AXP192ApsWarningCode(this->shutdown_warning_mv_));
+                Write1Byte(0x3B, AXP192ApsWarningCode(this->shutdown_mv_));
+            }
+
+            if (ModelTraits::BATTERY_SETUP)
+            {
+                // Bat charge voltage to 4.2, Current 100MA
+                Write1Byte(0x33, 0xc0);
+
+                // 128ms power on, 4s power off
+                Write1Byte(0x36, 0x0C);
+
+                // Disable vbus hold limit
                 Write1Byte(0x30, 0x80);
 
-                // Enable RTC BAT charge
-                Write1Byte(0x35, 0xa2 & (disableRTC ? 0x7F : 0xFF));
+                // Enable RTC BAT charge
+                Write1Byte(0x35, 0xa2 & (ModelTraits::DISABLE_RTC ? 0x7F : 0xFF));
+
+                // Enable bat detection
+                Write1Byte(0x32, 0x46);
+            }
+
+            // Set charge current
+            SetChargeCurrent(this->charge_current_);
+            this->charge_step_ = this->charge_current_;
+
+            if (this->charge_controller_)
+            {
+                // VHOLD 100mV below the controller floor as a hardware backstop, 4.0V + n * 100mV
+                uint8_t vhold = clamp((this->charge_vbus_min_mv_ - 4100) / 100, (int32_t) 0, (int32_t) 7);
+                UpdateBits(0x30, 0x78, 0x40 | (vhold << 3));
+            }
+
+            // Program IRQ enables 0x40..0x43 and the timer IRQ 0x4A, and drop anything latched before boot. Written
+            // even without events, the OTP defaults would otherwise pull the IRQ line low on their own
+            for (uint8_t i = 0; i < 4; i++)
+            {
+                Write1Byte(0x40 + i, (this->irq_enable_mask_ >> (24 - 8 * i)) & 0xff);
+                Write1Byte(0x44 + i, 0xff);
+            }
+            Write1Byte(0x4A, 0x00);
+            Write1Byte(0x4D, 0xff);
+
+            FlushWriteBatch();
+        }
+
+        uint16_t AXP192Component::ConfiguredAdcChannels()
+        {
+            uint16_t channels = 0;
+            if (this->batterylevel_sensor_ != nullptr)
+                channels |= ADC_BAT_VOLTAGE;
+            if (this->charge_controller_)
+                channels |= ADC_VBUS_VOLTAGE | ADC_VBUS_CURRENT | ADC_TEMPERATURE;
+            if (this->history_interval_ > 0)
+                channels |= ADC_BAT_VOLTAGE | ADC_VBUS_VOLTAGE | ADC_TEMPERATURE;
+            if (EnergyUsed())
+                channels |= ADC_BAT_VOLTAGE | ADC_BAT_CURRENT | ADC_VBUS_VOLTAGE | ADC_VBUS_CURRENT | ADC_VIN_VOLTAGE | ADC_VIN_CURRENT;
+            if (this->shutdown_enabled_)
+                channels |= ADC_APS_VOLTAGE;
+            for (uint8_t i = 0; i < CHANNEL_COUNT; i++)
+            {
+                if (ChannelUsed(i))
+                    channels |= AXP192_CHANNEL_ADC[i];
+            }
+            return channels;
+        }
+
+        uint32_t AXP192Component::ConfigSignature()
+        {
+            // FNV-1a over everything begin() derives its writes from, plus the codegen hash of the YAML and the
+            // component sources so a changed firmware re-runs it
+            uint32_t hash = 2166136261UL;
+            auto mix = [&hash](const void *data, size_t len) {
+                const uint8_t *bytes = static_cast<const uint8_t *>(data);
+                for (size_t i = 0; i < len; i++)
+                {
+                    hash = (hash ^ bytes[i]) * 16777619UL;
+                }
+            };
+#ifdef AXP192_CONFIG_HASH
+            const uint32_t config_hash = AXP192_CONFIG_HASH;
+            mix(&config_hash, sizeof(config_hash));
+#endif
+            mix(ModelTraits::NAME, strlen(ModelTraits::NAME));
+            mix(&this->charge_current_, sizeof(this->charge_current_));
+            mix(&this->irq_enable_mask_, sizeof(this->irq_enable_mask_));
+            uint16_t channels = ConfiguredAdcChannels();
+            mix(&channels, sizeof(channels));
+            mix(&this->shutdown_warning_mv_, sizeof(this->shutdown_warning_mv_));
+            mix(&this->shutdown_mv_, sizeof(this->shutdown_mv_));
+            return hash;
+        }
+
+        void AXP192Component::SaveSleepState()
+        {
+            // Every register SetSleep() touches has to be known, or the wake cannot put it back
+            wake_rtc.magic = 0;
+            for (uint8_t i = 0; i < AXP192_SLEEP_REGISTER_COUNT; i++)
+            {
+                uint8_t value;
+                if (!ReadByte(AXP192_SLEEP_REGISTERS[i], &value))
+                    return;
+            }
+            wake_rtc.signature = ConfigSignature();
+            wake_rtc.cache_valid = reg_cache_valid_;
+            memcpy(wake_rtc.cache, reg_cache_, sizeof(wake_rtc.cache));
+        }
+
+        void AXP192Component::SaveSleptState()
+        {
+            for (uint8_t i = 0; i < AXP192_SLEEP_REGISTER_COUNT; i++)
+            {
+                int8_t idx = CacheIndex(AXP192_SLEEP_REGISTERS[i]);
+                if (!(reg_cache_valid_ & (1UL << idx)))
+                    return;
+                wake_rtc.slept[i] = reg_cache_[idx];
+            }
+            wake_rtc.magic = AXP192_WAKE_MAGIC;
+        }
+
+        bool AXP192Component::RestoreFromSleep()
+        {
+            if (wake_rtc.magic != AXP192_WAKE_MAGIC || wake_rtc.signature != ConfigSignature())
+            {
+                return false;
+            }
+
+            // The PMIC kept its registers through the sleep, start from what it held before SetSleep()
+            memcpy(reg_cache_, wake_rtc.cache, sizeof(reg_cache_));
+            reg_cache_valid_ = wake_rtc.cache_valid;
+            for (uint8_t i = 0; i < AXP192_SLEEP_REGISTER_COUNT; i++)
+            {
+                reg_cache_valid_ &= ~(1UL << CacheIndex(AXP192_SLEEP_REGISTERS[i]));
+            }
+
+            // Only the sleep delta is verified, anything unexpected means a full init
+            for (uint8_t i = 0; i < AXP192_SLEEP_REGISTER_COUNT; i++)
+            {
+                uint8_t value;
+                if (!ReadByte(AXP192_SLEEP_REGISTERS[i], &value) || value != wake_rtc.slept[i])
+                {
+                    ESP_LOGD(TAG, "Register 0x%02X changed during sleep, running full init", AXP192_SLEEP_REGISTERS[i]);
+                    reg_cache_valid_ = 0;
+                    return false;
+                }
+            }
+
+            BeginWriteBatch();
+            for (uint8_t i = 0; i < AXP192_SLEEP_REGISTER_COUNT; i++)
+            {
+                Write1Byte(AXP192_SLEEP_REGISTERS[i], wake_rtc.cache[CacheIndex(AXP192_SLEEP_REGISTERS[i])]);
+            }
+            if (this->irq_enable_mask_ != 0)
+            {
+                // Enables survived, only drop what latched while asleep
+                for (uint8_t i = 0; i < 4; i++)
+                {
+                    Write1Byte(0x44 + i, 0xff);
+                }
+            }
+            FlushWriteBatch();
+
+            // The charge controller carries on from the restored current rather than its first step
+            this->charge_step_ = reg_cache_[CacheIndex(0x33)] & 0x07;
+            adc_rate_ = static_cast<AXP192AdcRate>(reg_cache_[CacheIndex(0x84)] >> 6);
+
+            // With duty cycling the sleep was entered with only the idle channels on
+            adc_channels_ = (reg_cache_[CacheIndex(0x82)] << 8) | reg_cache_[CacheIndex(0x83)] | ConfiguredAdcChannels();
+            adc_powered_ = !this->adc_duty_cycle_;
+            adc_configured_ = true;
+            return true;
+        }
+
+        int8_t AXP192Component::CacheIndex(uint8_t Addr)
+        {
+            for (uint8_t i = 0; i < AXP192_CACHED_REGISTER_COUNT; i++)
+            {
+                if (AXP192_CACHED_REGISTERS[i] == Addr)
+                    return i;
+            }
+            return -1;
+        }
+
+        void AXP192Component::ResyncRegisters()
+        {
+            reg_cache_valid_ = 0;
+            for (uint8_t i = 0; i < AXP192_CACHED_REGISTER_COUNT; i++)
+            {
+                Read8bit(AXP192_CACHED_REGISTERS[i]);
+            }
+        }
+
+        void AXP192Component::UpdateBits(uint8_t Addr, uint8_t Mask, uint8_t Value)
+        {
+            uint8_t current;
+            if (!ReadByte(Addr, &current))
+            {
+                // Don't write back bits we failed to read
+                return;
+            }
+            Write1Byte(Addr, (current & ~Mask) | (Value & Mask));
+        }
+
+        void AXP192Component::BeginWriteBatch()
+        {
+            write_batch_active_ = true;
+        }
+
+        void AXP192Component::FlushWriteBatch()
+        {
+            write_batch_active_ = false;
+            if (write_batch_len_ == 0)
+            {
+                return;
+            }
+
+            uint8_t len = write_batch_len_;
+            write_batch_len_ = 0;
+            if (WriteBytes(write_batch_, len))
+            {
+                return;
+            }
+
+            // Multi-write rejected, fall back to one transaction per register
+            ESP_LOGW(TAG, "Batched write of %d registers failed, retrying individually", len / 2);
+            for (uint8_t i = 0; i < len; i += 2)
+            {
+                int8_t idx = CacheIndex(write_batch_[i]);
+                if (idx >= 0)
+                {
+                    reg_cache_valid_ &= ~(1UL << idx);
+                }
+                Write1Byte(write_batch_[i], write_batch_[i + 1]);
+            }
+        }
+
+        void AXP192Component::Write1Byte(uint8_t Addr, uint8_t Data)
+        {
+            int8_t idx = CacheIndex(Addr);
+            if (idx >= 0 && (reg_cache_valid_ & (1UL << idx)) && reg_cache_[idx] == Data)
+            {
+                // Register already holds this value
+                return;
+            }
+
+            if (write_batch_active_)
+            {
+                uint8_t i = 0;
+                while (i < write_batch_len_ && write_batch_[i] != Addr)
+                {
+                    i += 2;
+                }
+                if (i == write_batch_len_)
+                {
+                    if (write_batch_len_ == sizeof(write_batch_))
+                    {
+                        FlushWriteBatch();
+                        write_batch_active_ = true;
+                        i = 0;
+                    }
+                    write_batch_[i] = Addr;
+                    write_batch_len_ = i + 2;
+                }
+                write_batch_[i + 1] = Data;
+                if (idx >= 0)
+                {
+                    reg_cache_[idx] = Data;
+                    reg_cache_valid_ |= (1UL << idx);
+                }
+                return;
+            }
+
+            uint8_t buf[2] = {Addr, Data};
+            bool ok = WriteBytes(buf, sizeof(buf));
+            if (idx >= 0)
+            {
+                if (ok)
+                {
+                    reg_cache_[idx] = Data;
+                    reg_cache_valid_ |= (1UL << idx);
+                }
+                else
+                {
+                    reg_cache_valid_ &= ~(1UL << idx);
+                }
+            }
+        }
+
+        uint8_t AXP192Component::Read8bit(uint8_t Addr)
+        {
+            // Callers that must not act on a failed read use ReadByte()
+            uint8_t data = 0;
+            ReadByte(Addr, &data);
+            return data;
+        }
+
+        bool AXP192Component::ReadByte(uint8_t Addr, uint8_t *Data)
+        {
+            int8_t idx = CacheIndex(Addr);
+            if (idx >= 0 && (reg_cache_valid_ & (1UL << idx)))
+            {
+                *Data = reg_cache_[idx];
+                return true;
+            }
+
+            for (uint8_t i = 0; i < write_batch_len_; i += 2)
+            {
+                if (write_batch_[i] == Addr)
+                {
+                    // Uncached register with a queued write, make it land before reading back
+                    FlushWriteBatch();
+                    write_batch_active_ = true;
+                    break;
+                }
+            }
+
+            if (!ReadBytes(Addr, Data, 1))
+            {
+                return false;
+            }
+            if (idx >= 0)
+            {
+                reg_cache_[idx] = *Data;
+                reg_cache_valid_ |= (1UL << idx);
+            }
+            return true;
+        }
+
+        bool AXP192Component::Read16bit(uint8_t Addr, uint16_t *Data)
+        {
+            uint8_t Buff[2];
+            bool ok = ReadBuff(Addr, sizeof(Buff), Buff);
+            *Data = (Buff[0] << 8) | Buff[1];
+            return ok;
+        }
+
+        bool AXP192Component::Read24bit(uint8_t Addr, uint32_t *Data)
+        {
+            uint32_t ReData = 0;
+            uint8_t Buff[3];
+            bool ok = ReadBuff(Addr, sizeof(Buff), Buff);
+            for (uint8_t i = 0; i < sizeof(Buff); i++)
+            {
+                ReData <<= 8;
+                ReData |= Buff[i];
+            }
+            *Data = ReData;
+            return ok;
+        }
+
+        bool AXP192Component::Read32bit(uint8_t Addr, uint32_t *Data)
+        {
+            uint32_t ReData = 0;
+            uint8_t Buff[4];
+            bool ok = ReadBuff(Addr, sizeof(Buff), Buff);
+            for (uint8_t i = 0; i < sizeof(Buff); i++)
+            {
+                ReData <<= 8;
+                ReData |= Buff[i];
+            }
+            *Data = ReData;
+            return ok;
+        }
+
+        bool AXP192Component::ReadBuff(uint8_t Addr, uint8_t Size, uint8_t *Buff)
+        {
+            if (Addr >= adc_block_first_ && Addr + Size - 1 <= adc_block_last_)
+            {
+                memcpy(Buff, &adc_block_[Addr - AXP192_ADC_BLOCK_START], Size);
+                return true;
+            }
+            if (!ReadBytes(Addr, Buff, Size))
+            {
+                // Never hand out stack garbage
+                memset(Buff, 0, Size);
+                return false;
+            }
+            return true;
+        }
+
+        template <typename F>
+        bool AXP192Component::RunTransaction(F &&transfer)
+        {
+            // Bounded retry with exponential backoff, every attempt is accounted for
+            uint32_t start = micros();
+            i2c::ErrorCode err = transfer();
+            for (uint8_t attempt = 0; err != i2c::ERROR_OK && attempt < AXP192_I2C_RETRIES; attempt++)
+            {
+                delayMicroseconds(AXP192_I2C_BACKOFF_US << attempt);
+                this->i2c_stats_.retries++;
+                err = transfer();
+            }
+
+            uint32_t latency = micros() - start;
+            uint8_t bucket = 0;
+            for (uint32_t limit = AXP192_LATENCY_BUCKET_US; bucket < AXP192_LATENCY_BUCKETS - 1 && latency >= limit; limit <<= 1)
+            {
+                bucket++;
+            }
+            this->i2c_stats_.latency_histogram[bucket]++;
+            this->i2c_stats_.transactions++;
+            if (latency > this->i2c_stats_.latency_max)
+            {
+                this->i2c_stats_.latency_max = latency;
+            }
+
+            if (err != i2c::ERROR_OK)
+            {
+                this->i2c_stats_.failures++;
+                this->status_set_warning();
+                return false;
+            }
+            return true;
+        }
+
+        bool AXP192Component::ReadBytes(uint8_t Addr, uint8_t *Buff, uint8_t Size)
+        {
+            AXP192_TRACE_BEGIN(trace_start);
+            bool ok = RunTransaction([&]() { return this->read_register(Addr, Buff, Size); });
+            AXP192_TRACE(TRACE_READ, Addr, AXP192TraceSince(trace_start));
+            if (!ok)
+            {
+                ESP_LOGW(TAG, "Reading %d bytes from 0x%02X failed", Size, Addr);
+            }
+            return ok;
+        }
+
+        bool AXP192Component::WriteBytes(const uint8_t *Data, uint8_t Size)
+        {
+            // Data holds the register address followed by the payload, or address/value pairs
+            AXP192_TRACE_BEGIN(trace_start);
+            bool ok = RunTransaction([&]() { return this->write(Data, Size); });
+            AXP192_TRACE(TRACE_WRITE, Data[0], AXP192TraceSince(trace_start));
+            if (!ok)
+            {
+                ESP_LOGW(TAG, "Writing %d bytes to 0x%02X failed", Size - 1, Data[0]);
+            }
+            return ok;
+        }
+
+        bool AXP192Component::ReadAdcBlock()
+        {
+            return ReadAdcRange(AXP192_ADC_BLOCK_START, AXP192_ADC_BLOCK_END);
+        }
+
+        bool AXP192Component::ReadAdcRange(uint8_t first, uint8_t last)
+        {
+            if (first >= adc_block_first_ && last <= adc_block_last_)
+            {
+                // Already held
+                return true;
+            }
+            ReleaseAdcBlock();
+            if (!ReadBytes(first, &adc_block_[first - AXP192_ADC_BLOCK_START], last - first + 1))
+            {
+                return false;
+            }
+            adc_block_first_ = first;
+            adc_block_last_ = last;
+            return true;
+        }
+
+        void AXP192Component::UpdateBrightness()
+        {
+            if (brightness_ == curr_brightness_ || ModelTraits::BACKLIGHT_REG == 0)
+            {
+                return;
+            }
+
+            ESP_LOGV(TAG, "Brightness=%f (Curr: %f)", brightness_, curr_brightness_);
+
+            // Perceived lightness to luminance (CIE 1931) in 16 segments, interpolated and spread over every voltage step
+            float level = clamp(brightness_, 0.0f, 1.0f) * 16.0f;
+            uint8_t segment = std::min(static_cast<uint8_t>(level), static_cast<uint8_t>(15));
+            float luminance = AXP192_BACKLIGHT_CURVE[segment] +
+                              (level - segment) * (AXP192_BACKLIGHT_CURVE[segment + 1] - AXP192_BACKLIGHT_CURVE[segment]);
+            uint8_t code = ModelTraits::BACKLIGHT_MIN +
+                           static_cast<uint8_t>(luminance * (ModelTraits::BACKLIGHT_MAX - ModelTraits::BACKLIGHT_MIN) / 255.0f + 0.5f);
+
+            // Only the voltage field write goes out when the code changed, the cache skips the rest
+            BeginWriteBatch();
+            UpdateBits(ModelTraits::BACKLIGHT_REG, ModelTraits::BACKLIGHT_MASK, code << ModelTraits::BACKLIGHT_SHIFT);
+
+            if (ModelTraits::BACKLIGHT_RAIL != 0)
+            {
+                // Switch the backlight rail off at zero brightness and back on when coming off it, in the same transfer
+                UpdateBits(0x12, ModelTraits::BACKLIGHT_RAIL, brightness_ > 0 ? ModelTraits::BACKLIGHT_RAIL : 0);
+            }
+            FlushWriteBatch();
+
+            curr_brightness_ = brightness_;
+        }
+
+        void AXP192Component::RegisterAdcChannels(uint16_t channels, AXP192AdcRate min_rate)
+        {
+            adc_channels_ |= channels;
+            if (min_rate > adc_rate_)
+            {
+                adc_rate_ = min_rate;
+            }
+            if (adc_configured_)
+            {
+                WriteAdcConfig();
+            }
+        }
+
+        void AXP192Component::WriteAdcConfig()
+        {
+            if (this->fuel_gauge_ready_ && Read8bit(0x84) >> 6 != adc_rate_)
+            {
+                // Counts taken at the old rate have a different weight, fold them in first
+                RebaseFuelGauge();
+            }
+
+            // Sample rate in bits 7:6, keep TS pin current source and function settings
+            Write1Byte(0x84, (adc_rate_ << 6) | 0b00110010);
+            uint16_t channels = adc_powered_ ? adc_channels_ : AdcIdleChannels();
+            Write1Byte(0x82, channels >> 8);
+            Write1Byte(0x83, channels & 0xff);
+        }
+
+        uint16_t AXP192Component::AdcIdleChannels()
+        {
+            // The coulomb counter integrates the battery current ADC, the APS low voltage warning compares the APS ADC
+            uint16_t channels = 0;
+            if (this->battery_capacity_ > 0.0f)
+                channels |= ADC_BAT_CURRENT;
+            if (this->irq_enable_mask_ & AXP192_EVENT_IRQ_BITS[EVENT_LOW_BATTERY])
+                channels |= ADC_APS_VOLTAGE;
+            return channels & adc_channels_;
+        }
+
+        uint32_t AXP192Component::AdcSettleTime()
+        {
+            // Two sample periods: the one in progress when the channels came on and a full conversion after it
+            if (this->adc_settle_time_ > 0)
+                return this->adc_settle_time_;
+            return 2 * 1000u / (25u << adc_rate_);
+        }
+
+        bool AXP192Component::GetBatState()
+        {
+            // 0x01 bit 5 is battery present
+            uint8_t status;
+            return ReadByte(0x01, &status) && (status & 0x20);
+        }
+
+        uint8_t AXP192Component::GetBatData()
+        {
+            return Read8bit(0x75);
+        }
+
+        //---------coulombcounter_from_here---------
+        // enable: void EnableCoulombCounter(void);
+        // disable: void DisableCOulombCounter(void);
+        // stop: void StopCoulombCounter(void);
+        // clear: void ClearCoulombCounter(void);
+        // get charge data: uint32_t GetCoulombChargeData(void);
+        // get discharge data: uint32_t GetCoulombDischargeData(void);
+        // get coulomb val affter calculation: float GetCoulombData(void);
+        //------------------------------------------
+        void AXP192Component::EnableCoulombCounter(void)
+        {
+            Write1Byte(0xB8, 0x80);
+        }
+
+        void AXP192Component::DisableCoulombCounter(void)
+        {
+            Write1Byte(0xB8, 0x00);
+        }
+
+        void AXP192Component::StopCoulombCounter(void)
+        {
+            Write1Byte(0xB8, 0xC0);
+        }
+
+        void AXP192Component::ClearCoulombCounter(void)
+        {
+            Write1Byte(0xB8, 0xA0);
+        }
+
+        uint32_t AXP192Component::GetCoulombChargeData(void)
+        {
+            uint32_t ReData;
+            Read32bit(0xB0, &ReData);
+            return ReData;
+        }
+
+        uint32_t AXP192Component::GetCoulombDischargeData(void)
+        {
+            uint32_t ReData;
+            Read32bit(0xB4, &ReData);
+            return ReData;
+        }
+
+        float AXP192Component::GetCoulombData(void)
+        {
+            uint32_t coin = 0;
+            uint32_t coout = 0;
+
+            if (!Read32bit(0xB0, &coin) || !Read32bit(0xB4, &coout))
+            {
+                return NAN;
+            }
+
+            // c = 65536 * current_LSB * (coin - coout) / 3600 / ADC rate
+            float ccc = ((int64_t)coin - (int64_t)coout) * CoulombMahPerCount();
+            return ccc;
+        }
+
+        float AXP192Component::CoulombMahPerCount()
+        {
+            // The counter accumulates once per ADC sample, the rate is in 0x84 bits 7:6 (25Hz << n)
+            uint8_t rate_hz = 25 << (Read8bit(0x84) >> 6);
+            return 65536 * 0.5 / 3600.0 / rate_hz;
+        }
+
+        bool AXP192Component::ReadCoulombCounts(int64_t *net)
+        {
+            uint8_t buf[8];
+            if (!ReadBytes(0xB0, buf, sizeof(buf)))
+            {
+                return false;
+            }
+            uint32_t coin = ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) | ((uint32_t)buf[2] << 8) | buf[3];
+            uint32_t coout = ((uint32_t)buf[4] << 24) | ((uint32_t)buf[5] << 16) | ((uint32_t)buf[6] << 8) | buf[7];
+            *net = (int64_t)coin - (int64_t)coout;
+
+            if ((coin | coout) & 0x80000000)
+            {
+                // Clear well before the counters wrap; callers see the rebased value
+                ClearCoulombCounter();
+                float delta_mah = (*net - this->fuel_ref_counts_) * CoulombMahPerCount();
+                this->fuel_charge_mah_ += delta_mah;
+                this->fuel_coulomb_mah_ += delta_mah;
+                this->fuel_ref_counts_ = 0;
+                *net = 0;
+            }
+            return true;
+        }
+        //----------coulomb_end_at_here----------
+
+        //---------fuel_gauge_from_here---------
+        void AXP192Component::SetupFuelGauge()
+        {
+            // The counter integrates the battery current ADC
+            RegisterAdcChannels(ADC_BAT_VOLTAGE | ADC_BAT_CURRENT);
+
+            uint8_t counter_control;
+            if (!ReadByte(0xB8, &counter_control))
+            {
+                ESP_LOGW(TAG, "Coulomb counter unreadable, battery level falls back to voltage");
+                return;
+            }
+            bool counter_running = counter_control & 0x80;
+            bool warm = counter_running && fuel_gauge_rtc.magic == AXP192_FUEL_GAUGE_MAGIC &&
+                        fuel_gauge_rtc.adc_rate == adc_rate_;
+            if (warm)
+            {
+                // Warm start: the PMIC kept counting while the ESP slept
+                this->fuel_charge_mah_ = fuel_gauge_rtc.charge_mah;
+                this->fuel_ref_counts_ = fuel_gauge_rtc.ref_counts;
+                ESP_LOGD(TAG, "Fuel gauge restored: %.1f mAh", this->fuel_charge_mah_);
+            }
+
+            int64_t counts;
+            if (!ReadCoulombCounts(&counts))
+            {
+                ESP_LOGW(TAG, "Coulomb counter unreadable, battery level falls back to voltage");
+                return;
+            }
+
+            if (!warm)
+            {
+                // Cold start: seed from the open-circuit voltage estimate
+                float vbat = GetBatVoltage();
+                if (std::isnan(vbat))
+                {
+                    // OcvToSoc() would make that a full battery
+                    ESP_LOGW(TAG, "Battery voltage unreadable, battery level falls back to voltage");
+                    return;
+                }
+                if (!counter_running)
+                {
+                    EnableCoulombCounter();
+                }
+                this->fuel_charge_mah_ = this->battery_capacity_ * OcvToSoc(vbat) / 100.0f;
+                this->fuel_ref_counts_ = counts;
+                ESP_LOGD(TAG, "Fuel gauge seeded from OCV: %.1f mAh", this->fuel_charge_mah_);
+            }
+
+            this->fuel_gauge_ready_ = true;
+            RebaseFuelGauge();
+        }
 
-                // Enable bat detection
-                Write1Byte(0x32, 0x46);
+        void AXP192Component::RebaseFuelGauge()
+        {
+            int64_t counts;
+            if (ReadCoulombCounts(&counts))
+            {
+                float delta_mah = (counts - this->fuel_ref_counts_) * CoulombMahPerCount();
+                this->fuel_charge_mah_ += delta_mah;
+                this->fuel_coulomb_mah_ += delta_mah;
+                this->fuel_ref_counts_ = counts;
             }
+            this->fuel_charge_mah_ = clamp(this->fuel_charge_mah_, 0.0f, this->battery_capacity_);
 
-            // Set charge current
-            SetChargeCurrent(this->charge_current_);
+            fuel_gauge_rtc.magic = AXP192_FUEL_GAUGE_MAGIC;
+            fuel_gauge_rtc.charge_mah = this->fuel_charge_mah_;
+            fuel_gauge_rtc.ref_counts = this->fuel_ref_counts_;
+            fuel_gauge_rtc.adc_rate = Read8bit(0x84) >> 6;
+        }
+
+        float AXP192Component::UpdateFuelGauge(float vbat, float ibat)
+        {
+            RebaseFuelGauge();
+
+            if (fabsf(ibat) < AXP192_REST_CURRENT)
+            {
+                if (this->fuel_rest_since_ == 0)
+                {
+                    this->fuel_rest_since_ = millis() | 1;
+                }
+                else if (millis() - this->fuel_rest_since_ >= AXP192_REST_TIME && !std::isnan(vbat))
+                {
+                    // Relaxed battery, pull the integrated charge towards the OCV estimate
+                    float ocv_mah = this->battery_capacity_ * OcvToSoc(vbat) / 100.0f;
+                    this->fuel_charge_mah_ += AXP192_OCV_WEIGHT * (ocv_mah - this->fuel_charge_mah_);
+                    fuel_gauge_rtc.charge_mah = this->fuel_charge_mah_;
+                }
+            }
+            else
+            {
+                this->fuel_rest_since_ = 0;
+            }
 
+            return 100.0f * this->fuel_charge_mah_ / this->battery_capacity_;
         }
 
-        void AXP192Component::Write1Byte(uint8_t Addr, uint8_t Data)
+        float AXP192Component::OcvToSoc(float vbat)
         {
-            this->write_byte(Addr, Data);
+            float mv = vbat * 1000.0f;
+            if (mv <= AXP192_OCV_TABLE[0])
+                return 0.0f;
+            for (uint8_t i = 1; i <= AXP192_OCV_STEPS; i++)
+            {
+                if (mv < AXP192_OCV_TABLE[i])
+                {
+                    float frac = (mv - AXP192_OCV_TABLE[i - 1]) / (AXP192_OCV_TABLE[i] - AXP192_OCV_TABLE[i - 1]);
+                    return 100.0f * (i - 1 + frac) / AXP192_OCV_STEPS;
+                }
+            }
+            return 100.0f;
         }
 
-        uint8_t AXP192Component::Read8bit(uint8_t Addr)
+        bool AXP192Component::RuntimeUsed()
         {
-            uint8_t data;
-            this->read_byte(Addr, &data);
-            return data;
+            return this->time_to_empty_sensor_ != nullptr || this->time_to_full_sensor_ != nullptr;
         }
 
-        uint16_t AXP192Component::Read12Bit(uint8_t Addr)
+        void AXP192Component::UpdateRuntime()
         {
-            uint16_t Data = 0;
-            uint8_t buf[2];
-            ReadBuff(Addr, 2, buf);
-            Data = ((buf[0] << 4) + buf[1]); //
-            return Data;
+            float time_to_empty = NAN;
+            float time_to_full = NAN;
+            if (this->fuel_gauge_ready_)
+            {
+                if (this->batterylevel_sensor_ == nullptr)
+                {
+                    // Otherwise PublishBatteryLevel() has just folded the counter in
+                    RebaseFuelGauge();
+                }
+
+                uint32_t now = millis();
+                // A failed status read keeps the direction last seen, rather than reseeding as a charger change
+                bool charging = this->runtime_charging_;
+                uint8_t status;
+                if (ReadByte(0x01, &status))
+                    charging = status & (1 << 6);
+                if (!this->runtime_primed_ || charging != this->runtime_charging_)
+                {
+                    // Charger plugged or unplugged: the average describes the other direction, restart from this sample.
+                    // The sample can predate the change by one acquisition, or the first conversion; if it points the
+                    // old way, the counter mean over the next update replaces the average instead
+                    float ibat = GetBatCurrent();
+                    bool agrees = charging ? ibat > 0.0f : ibat < 0.0f;
+                    this->runtime_current_ma_ = agrees ? ibat : 0.0f;
+                    this->runtime_reseed_ = !agrees;
+                    this->runtime_charging_ = charging;
+                    this->runtime_primed_ = true;
+                }
+                else if (now != this->runtime_last_time_)
+                {
+                    // Mean current since the previous update from the counter, so peaks between updates count too
+                    uint32_t elapsed = now - this->runtime_last_time_;
+                    float mean_ma = (this->fuel_coulomb_mah_ - this->runtime_last_mah_) * 3600000.0f / elapsed;
+                    if (this->runtime_reseed_)
+                        this->runtime_current_ma_ = mean_ma;
+                    else
+                        this->runtime_current_ma_ += (1.0f - expf(-(float) elapsed / AXP192_RUNTIME_TAU_MS)) * (mean_ma - this->runtime_current_ma_);
+                    this->runtime_reseed_ = false;
+                }
+                this->runtime_last_mah_ = this->fuel_coulomb_mah_;
+                this->runtime_last_time_ = now;
+
+                if (this->runtime_current_ma_ < -AXP192_REST_CURRENT)
+                {
+                    time_to_empty = this->fuel_charge_mah_ / -this->runtime_current_ma_ * 60.0f;
+                }
+                else if (this->runtime_current_ma_ > AXP192_REST_CURRENT)
+                {
+                    time_to_full = (this->battery_capacity_ - this->fuel_charge_mah_) / this->runtime_current_ma_ * 60.0f;
+                }
+            }
+
+            ESP_LOGV(TAG, "Battery current average %.1f mA", this->runtime_current_ma_);
+            if (this->time_to_empty_sensor_ != nullptr)
+                this->time_to_empty_sensor_->publish_state(time_to_empty);
+            if (this->time_to_full_sensor_ != nullptr)
+                this->time_to_full_sensor_->publish_state(time_to_full);
         }
+        //----------fuel_gauge_end_at_here----------
 
-        uint16_t AXP192Component::Read13Bit(uint8_t Addr)
+        //----------charge_controller_start_from_here----------
+        uint8_t AXP192Component::InternalChannels()
         {
-            uint16_t Data = 0;
-            uint8_t buf[2];
-            ReadBuff(Addr, 2, buf);
-            Data = ((buf[0] << 5) + buf[1]); //
-            return Data;
+            uint8_t channels = 0;
+            if (this->charge_controller_)
+                channels |= (1 << CHANNEL_VBUS_VOLTAGE) | (1 << CHANNEL_VBUS_CURRENT) | (1 << CHANNEL_TEMPERATURE);
+            if (this->history_interval_ > 0)
+                channels |= (1 << CHANNEL_BAT_VOLTAGE) | (1 << CHANNEL_VBUS_VOLTAGE) | (1 << CHANNEL_TEMPERATURE);
+            if (RuntimeUsed() && this->fuel_gauge_ready_)
+                channels |= (1 << CHANNEL_BAT_CURRENT);
+            return channels;
         }
 
-        uint16_t AXP192Component::Read16bit(uint8_t Addr)
+        void AXP192Component::ControlChargeCurrent()
         {
-            uint32_t ReData = 0;
-            uint8_t Buff[2];
-            this->read_bytes(Addr, Buff, sizeof(Buff));
-            for (int i = 0; i < sizeof(Buff); i++)
+            int32_t vbus_mv, vbus_ma, temp_mc;
+            if (!DecodeQuantity(QUANTITY_VBUS_VOLTAGE, &vbus_mv) || !DecodeQuantity(QUANTITY_VBUS_CURRENT, &vbus_ma) ||
+                !DecodeQuantity(QUANTITY_TEMPERATURE, &temp_mc))
             {
-                ReData <<= 8;
-                ReData |= Buff[i];
+                return;
+            }
+
+            // Without the power status the step stays where it is; a failed read is not an unplugged supply
+            uint8_t power_status, charge_status;
+            if (!ReadByte(0x00, &power_status))
+                return;
+
+            uint8_t step = this->charge_step_;
+            if (!(power_status & (1 << 5)))
+            {
+                // No VBUS, start from the configured current next time it shows up
+                step = this->charge_current_;
+            }
+            else if (vbus_mv < this->charge_vbus_min_mv_ || vbus_ma > this->charge_vbus_limit_ma_ || temp_mc > this->charge_max_temp_mc_)
+            {
+                // Sagging supply, over budget or hot: back off straight away
+                if (step > 0)
+                    step--;
+            }
+            else if (step < this->charge_ceiling_ && millis() - this->charge_last_raise_ >= AXP192_CHARGE_SETTLE_MS &&
+                     ReadByte(0x01, &charge_status) && (charge_status & (1 << 6)) &&
+                     vbus_mv >= this->charge_vbus_min_mv_ + AXP192_CHARGE_VBUS_MARGIN_MV &&
+                     temp_mc <= this->charge_max_temp_mc_ - AXP192_CHARGE_TEMP_MARGIN_MC &&
+                     vbus_ma + (AXP192_CHARGE_CURRENT_MA[step + 1] - AXP192_CHARGE_CURRENT_MA[step]) <= this->charge_vbus_limit_ma_)
+            {
+                // Charging with headroom for the next step; worst case the whole increase shows up on VBUS
+                step++;
+                this->charge_last_raise_ = millis();
+            }
+
+            if (step != this->charge_step_)
+            {
+                ESP_LOGD(TAG, "Charge current %u mA (VBUS %d mV %d mA, PMIC %d C)", (unsigned) AXP192_CHARGE_CURRENT_MA[step],
+                         (int) vbus_mv, (int) vbus_ma, (int) (temp_mc / 1000));
+                this->charge_step_ = step;
+                SetChargeCurrent(step);
             }
-            return ReData;
         }
+        //----------charge_controller_end_at_here----------
 
-        uint32_t AXP192Component::Read24bit(uint8_t Addr)
+        //----------low_battery_shutdown_start_from_here----------
+        void AXP192Component::EmergencyShutdown(uint32_t warning_us)
         {
-            uint32_t ReData = 0;
-            uint8_t Buff[3];
-            this->read_bytes(Addr, Buff, sizeof(Buff));
-            for (int i = 0; i < sizeof(Buff); i++)
+            if (this->shutdown_started_)
             {
-                ReData <<= 8;
-                ReData |= Buff[i];
+                return;
             }
-            return ReData;
+            this->shutdown_started_ = true;
+            this->shutdown_warning_us_ = warning_us;
+
+            ESP_LOGW(TAG, "Battery below %d mV, shutting down", (int) this->shutdown_mv_);
+            if (!this->shutdown_automation_)
+            {
+                FinishShutdown();
+                return;
+            }
+            // The automation runs alongside; whatever it has not done by the deadline is skipped
+            this->shutdown_callback_.call();
+            this->set_timeout("low_battery_shutdown", this->shutdown_deadline_, [this]() { FinishShutdown(); });
         }
 
-        uint32_t AXP192Component::Read32bit(uint8_t Addr)
+        void AXP192Component::FinishShutdown()
         {
-            uint32_t ReData = 0;
-            uint8_t Buff[4];
-            this->read_bytes(Addr, Buff, sizeof(Buff));
-            for (int i = 0; i < sizeof(Buff); i++)
+            uint32_t latency_ms = std::min<uint32_t>((micros() - this->shutdown_warning_us_) / 1000, 0xFFFF);
+            ESP_LOGW(TAG, "Low battery shutdown %u ms after the warning", (unsigned) latency_ms);
+
+            // The data buffer is kept by the PMIC while the ESP is unpowered, the next boot reports it
+            BeginWriteBatch();
+            Write1Byte(0x06, AXP192_SHUTDOWN_MARKER);
+            Write1Byte(0x07, latency_ms >> 8);
+            Write1Byte(0x08, latency_ms & 0xff);
+            FlushWriteBatch();
+
+            // Components flush pending state, this one commits the energy totals
+            App.run_safe_shutdown_hooks();
+            if (this->shutdown_deep_sleep_)
             {
-                ReData <<= 8;
-                ReData |= Buff[i];
+                const AXP192SleepProfile *profile = this->shutdown_profile_ != nullptr ? find_sleep_profile(this->shutdown_profile_) : nullptr;
+                DeepSleep(0, profile);
+            }
+            else
+            {
+                PowerOff();
             }
-            return ReData;
         }
 
-        void AXP192Component::ReadBuff(uint8_t Addr, uint8_t Size, uint8_t *Buff)
+        void AXP192Component::ReportLastShutdown()
         {
-            this->read_bytes(Addr, Buff, Size);
+            uint8_t buf[3];
+            if (!ReadBytes(0x06, buf, sizeof(buf)) || buf[0] != AXP192_SHUTDOWN_MARKER)
+            {
+                return;
+            }
+            ESP_LOGW(TAG, "Last low battery shutdown took %u ms from warning to power down", (unsigned) ((buf[1] << 8) | buf[2]));
+            Write1Byte(0x06, 0x00);
         }
+        //----------low_battery_shutdown_end_at_here----------
 
-        void AXP192Component::UpdateBrightness()
+        //----------history_start_from_here----------
+        void AXP192Component::LogHistorySample()
         {
-            if (brightness_ == curr_brightness_)
+#ifdef AXP192_HISTORY_BLOCKS
+            int32_t bat_mv, vbus_mv, temp_mc;
+            if (!DecodeQuantity(QUANTITY_BAT_VOLTAGE, &bat_mv) || !DecodeQuantity(QUANTITY_VBUS_VOLTAGE, &vbus_mv) ||
+                !DecodeQuantity(QUANTITY_TEMPERATURE, &temp_mc))
             {
                 return;
             }
+            int32_t values[3] = {bat_mv, vbus_mv, temp_mc / 100};
+            this->history_last_ = millis();
+            this->history_logged_ = true;
 
-            ESP_LOGD(TAG, "Brightness=%f (Curr: %f)", brightness_, curr_brightness_);
-
-            const uint8_t c_min = 7;
-            const uint8_t c_max = 12;
-            auto ubri = c_min + static_cast<uint8_t>(brightness_ * (c_max - c_min));
-
-            if (ubri > c_max)
+            if (history_rtc.magic != AXP192_HISTORY_RTC_MAGIC || history_rtc.head >= AXP192_HISTORY_BLOCKS)
             {
-                ubri = c_max;
+                memset(&history_rtc, 0, sizeof(history_rtc));
+                history_rtc.magic = AXP192_HISTORY_RTC_MAGIC;
             }
-            switch (this->model_)
-            {
-            case AXP192_M5STICKC:
-            {
-                ESP_LOGD(TAG, "Brightness AXP192_M5STICKC");
 
-                uint8_t buf = Read8bit(0x28);
-                Write1Byte(0x28, ((buf & 0x0f) | (ubri << 4)));
-
-                if (brightness_ == 0)
+            uint8_t *block = history_rtc.blocks[history_rtc.head];
+            uint8_t count = block[1];
+            if (block[0] == AXP192_HISTORY_MAGIC &&
+                AXP192_HISTORY_HEADER_SIZE + count * AXP192_HISTORY_RECORD_SIZE <= AXP192_HISTORY_BLOCK_SIZE)
+            {
+                // Deltas chain from the keyframe, rebuild the last sample to diff against
+                int32_t deltas[3];
+                bool fits = true;
+                for (uint8_t i = 0; i < 3; i++)
                 {
-                    // Then turn off the backlight power
-                    SetLDO2(false);
+                    int16_t last;
+                    memcpy(&last, &block[AXP192_HISTORY_HEADER_SIZE - 6 + 2 * i], 2);
+                    int32_t prev = last;
+                    for (uint8_t r = 1; r < count; r++)
+                        prev += (int8_t) block[AXP192_HISTORY_HEADER_SIZE + (r - 1) * AXP192_HISTORY_RECORD_SIZE + i];
+                    deltas[i] = values[i] - prev;
+                    fits &= deltas[i] >= -128 && deltas[i] <= 127;
                 }
-                else if (curr_brightness_ == 0)
+                if (fits)
                 {
-                    // We came off zero brightness -> turn backlight back on
-                    SetLDO2(true);
+                    uint8_t *record = &block[AXP192_HISTORY_HEADER_SIZE + (count - 1) * AXP192_HISTORY_RECORD_SIZE];
+                    for (uint8_t i = 0; i < 3; i++)
+                        record[i] = (uint8_t) (int8_t) deltas[i];
+                    block[1] = count + 1;
+                    return;
                 }
+            }
 
-                break;
+            // Full block, a jump too large for a delta, or nothing yet: start a keyframe
+            uint32_t sequence = 0;
+            if (block[0] == AXP192_HISTORY_MAGIC)
+            {
+                memcpy(&sequence, &block[4], 4);
+                sequence += count;
+                history_rtc.head = (history_rtc.head + 1) % AXP192_HISTORY_BLOCKS;
+                block = history_rtc.blocks[history_rtc.head];
             }
-            case AXP192_M5CORE2:
+            uint16_t interval_s = this->history_interval_ / 1000;
+            memset(block, 0, AXP192_HISTORY_BLOCK_SIZE);
+            block[0] = AXP192_HISTORY_MAGIC;
+            block[1] = 1;
+            memcpy(&block[2], &interval_s, 2);
+            memcpy(&block[4], &sequence, 4);
+            for (uint8_t i = 0; i < 3; i++)
             {
-                ESP_LOGD(TAG, "Brightness AXP192_M5CORE2");
+                int16_t value = values[i];
+                memcpy(&block[8 + 2 * i], &value, 2);
+            }
+#endif
+        }
 
-                uint8_t buf = Read8bit(0x27);
-                Write1Byte(0x27, ((buf & 0x80) | (ubri << 3)));
+        void AXP192Component::DumpHistory()
+        {
+#ifdef AXP192_HISTORY_BLOCKS
+            if (history_rtc.magic != AXP192_HISTORY_RTC_MAGIC)
+            {
+                ESP_LOGI(TAG, "HIST empty");
+                return;
+            }
+            // Oldest block first, one per loop iteration so the log never holds more than a line
+            this->history_dump_next_ = 0;
+#else
+            ESP_LOGW(TAG, "History is not configured");
+#endif
+        }
 
-                if (brightness_ == 0)
-                {
-                    // Then turn off the backlight power
-                    // SetLDO3(false); -> AXP_DC3
-                }
-                else if (curr_brightness_ == 0)
+        void AXP192Component::DumpHistoryBlock()
+        {
+#ifdef AXP192_HISTORY_BLOCKS
+            uint16_t index = (history_rtc.head + 1 + this->history_dump_next_) % AXP192_HISTORY_BLOCKS;
+            const uint8_t *block = history_rtc.blocks[index];
+            if (block[0] == AXP192_HISTORY_MAGIC)
+            {
+                char hex[2 * AXP192_HISTORY_BLOCK_SIZE + 1];
+                for (uint8_t i = 0; i < AXP192_HISTORY_BLOCK_SIZE; i++)
                 {
-                    // We came off zero brightness -> turn backlight back on
-                    // SetLDO3(true); -> AXP_DC3
+                    sprintf(&hex[2 * i], "%02X", block[i]);
                 }
-
-                break;
+                ESP_LOGI(TAG, "HIST %u %s", (unsigned) this->history_dump_next_, hex);
             }
-            case AXP192_M5TOUGH:
+            if (++this->history_dump_next_ >= AXP192_HISTORY_BLOCKS)
             {
-                ESP_LOGD(TAG, "Brightness AXP192_M5TOUGH");
-
-                uint8_t buf = Read8bit(0x27);
-                Write1Byte(0x27, ((buf & 0x80) | (ubri << 3)));
+                ESP_LOGI(TAG, "HIST end");
+                this->history_dump_next_ = -1;
+            }
+#else
+            this->history_dump_next_ = -1;
+#endif
+        }
+        //----------history_end_at_here----------
 
-                if (brightness_ == 0)
-                {
-                    // Then turn off the backlight power
-                    SetLDO3(false);
-                }
-                else if (curr_brightness_ == 0)
-                {
-                    // We came off zero brightness -> turn backlight back on
-                    SetLDO3(true);
-                }
+        //----------trace_start_from_here----------
+#ifdef AXP192_TRACE_RECORDS
+        static const char *const AXP192_TRACE_KIND_NAMES[TRACE_KIND_COUNT] = {"read", "write", "decode", "publish", "step"};
+        // Records logged per loop iteration while dumping
+        static const uint8_t AXP192_TRACE_DUMP_CHUNK = 8;
 
-                break;
-            }
-            case AXP192_TTGO_TCALL:
+        void AXP192Component::Trace(AXP192TraceKind kind, uint8_t reg, uint16_t value)
+        {
+            if (this->trace_dump_next_ >= 0)
             {
-                break;
+                // Paused, so the dump is one consistent window and does not trace its own log traffic
+                return;
             }
-            case AXP192_LILYGO_TCAMINI:
+            AXP192TraceRecord &record = this->trace_[this->trace_head_];
+            record.time_us = micros();
+            record.kind = kind;
+            record.reg = reg;
+            record.value = value;
+            if (++this->trace_head_ >= AXP192_TRACE_RECORDS)
+                this->trace_head_ = 0;
+            this->trace_total_++;
+        }
+
+        void AXP192Component::DumpTraceChunk()
+        {
+            uint32_t stored = std::min<uint32_t>(this->trace_total_, AXP192_TRACE_RECORDS);
+            uint16_t oldest = this->trace_total_ > AXP192_TRACE_RECORDS ? this->trace_head_ : 0;
+            for (uint8_t n = 0; n < AXP192_TRACE_DUMP_CHUNK && (uint32_t) this->trace_dump_next_ < stored; n++)
             {
-                break;
+                const AXP192TraceRecord &record = this->trace_[(oldest + this->trace_dump_next_) % AXP192_TRACE_RECORDS];
+                ESP_LOGI(TAG, "TRACE %10u %-7s 0x%02X %5u", (unsigned) record.time_us,
+                         record.kind < TRACE_KIND_COUNT ? AXP192_TRACE_KIND_NAMES[record.kind] : "?", record.reg, record.value);
+                this->trace_dump_next_++;
             }
+            if ((uint32_t) this->trace_dump_next_ >= stored)
+            {
+                ESP_LOGI(TAG, "TRACE end, %u records, %u overwritten", (unsigned) stored, (unsigned) (this->trace_total_ - stored));
+                this->trace_dump_next_ = -1;
             }
-
-            curr_brightness_ = brightness_;
         }
+#endif
 
-        bool AXP192Component::GetBatState()
+        void AXP192Component::DumpTrace()
         {
-            if (Read8bit(0x01) | 0x20)
-                return true;
-            else
-                return false;
+#ifdef AXP192_TRACE_RECORDS
+            this->trace_dump_next_ = 0;
+#else
+            ESP_LOGW(TAG, "Tracing is not configured");
+#endif
         }
+        //----------trace_end_at_here----------
 
-        uint8_t AXP192Component::GetBatData()
+        //----------energy_start_from_here----------
+        bool AXP192Component::EnergyUsed()
         {
-            return Read8bit(0x75);
+            for (uint8_t i = 0; i < ENERGY_COUNT; i++)
+            {
+                if (this->energy_sensors_[i] != nullptr)
+                    return true;
+            }
+            return false;
         }
 
-        //---------coulombcounter_from_here---------
-        // enable: void EnableCoulombCounter(void);
-        // disable: void DisableCOulombCounter(void);
-        // stop: void StopCoulombCounter(void);
-        // clear: void ClearCoulombCounter(void);
-        // get charge data: uint32_t GetCoulombChargeData(void);
-        // get discharge data: uint32_t GetCoulombDischargeData(void);
-        // get coulomb val affter calculation: float GetCoulombData(void);
-        //------------------------------------------
-        void AXP192Component::EnableCoulombCounter(void)
+        void AXP192Component::SetupEnergy()
         {
-            Write1Byte(0xB8, 0x80);
+            // The newest flash slot, unless RTC memory holds something at least as new
+            uint32_t hash = fnv1_hash("axp192_energy");
+            AXP192EnergyRecord record;
+            for (uint8_t slot = 0; slot < AXP192_ENERGY_SLOTS; slot++)
+            {
+                this->energy_prefs_[slot] = global_preferences->make_preference<AXP192EnergyRecord>(hash + slot, true);
+                if (this->energy_prefs_[slot].load(&record) && record.sequence >= this->energy_.sequence)
+                {
+                    this->energy_ = record;
+                }
+            }
+            if (energy_rtc.magic == AXP192_ENERGY_MAGIC && energy_rtc.record.sequence >= this->energy_.sequence)
+            {
+                this->energy_ = energy_rtc.record;
+                this->energy_uncommitted_ms_ = energy_rtc.uncommitted_ms;
+            }
+            ESP_LOGD(TAG, "Energy totals restored, commit %u", (unsigned) this->energy_.sequence);
         }
 
-        void AXP192Component::DisableCoulombCounter(void)
+        void AXP192Component::UpdateEnergy()
         {
-            Write1Byte(0xB8, 0x00);
+            int32_t bat_mv, charge_ma, discharge_ma, vbus_mv, vbus_ma, vin_mv, vin_ma;
+            if (!DecodeQuantity(QUANTITY_BAT_VOLTAGE, &bat_mv) || !DecodeQuantity(QUANTITY_BAT_CHARGE_CURRENT, &charge_ma) ||
+                !DecodeQuantity(QUANTITY_BAT_DISCHARGE_CURRENT, &discharge_ma) || !DecodeQuantity(QUANTITY_VBUS_VOLTAGE, &vbus_mv) ||
+                !DecodeQuantity(QUANTITY_VBUS_CURRENT, &vbus_ma) || !DecodeQuantity(QUANTITY_VIN_VOLTAGE, &vin_mv) ||
+                !DecodeQuantity(QUANTITY_VIN_CURRENT, &vin_ma))
+            {
+                // Don't integrate across a gap we know nothing about
+                this->energy_primed_ = false;
+                return;
+            }
+
+            // Power in µW; trapezoid over the interval, µW * ms accumulates nanojoules
+            int64_t power[ENERGY_COUNT] = {
+                (int64_t) bat_mv * charge_ma, (int64_t) bat_mv * discharge_ma, (int64_t) vbus_mv * vbus_ma, (int64_t) vin_mv * vin_ma};
+            uint32_t now = millis();
+            if (this->energy_primed_)
+            {
+                uint32_t dt = now - this->energy_last_time_;
+                for (uint8_t i = 0; i < ENERGY_COUNT; i++)
+                {
+                    this->energy_.nanojoules[i] += (power[i] + this->energy_last_power_[i]) * dt / 2;
+                }
+                this->energy_uncommitted_ms_ += dt;
+            }
+            memcpy(this->energy_last_power_, power, sizeof(power));
+            this->energy_last_time_ = now;
+            this->energy_primed_ = true;
+
+            energy_rtc.magic = AXP192_ENERGY_MAGIC;
+            energy_rtc.record = this->energy_;
+            energy_rtc.uncommitted_ms = this->energy_uncommitted_ms_;
+            if (this->energy_uncommitted_ms_ >= this->energy_commit_interval_)
+            {
+                CommitEnergy();
+            }
+
+            for (uint8_t i = 0; i < ENERGY_COUNT; i++)
+            {
+                if (this->energy_sensors_[i] != nullptr)
+                    this->energy_sensors_[i]->publish_state(this->energy_.nanojoules[i] / 3.6e12);
+            }
         }
 
-        void AXP192Component::StopCoulombCounter(void)
+        void AXP192Component::CommitEnergy()
         {
-            Write1Byte(0xB8, 0xC0);
+            // Each commit goes to the next slot, spreading the writes over AXP192_ENERGY_SLOTS entries
+            this->energy_.sequence++;
+            uint8_t slot = this->energy_.sequence % AXP192_ENERGY_SLOTS;
+            if (!this->energy_prefs_[slot].save(&this->energy_))
+            {
+                ESP_LOGW(TAG, "Saving energy totals failed");
+                this->energy_.sequence--;
+                return;
+            }
+            this->energy_uncommitted_ms_ = 0;
+            energy_rtc.magic = AXP192_ENERGY_MAGIC;
+            energy_rtc.record = this->energy_;
+            energy_rtc.uncommitted_ms = 0;
+            ESP_LOGD(TAG, "Energy totals committed to slot %u", slot);
         }
+        //----------energy_end_at_here----------
 
-        void AXP192Component::ClearCoulombCounter(void)
+        void AXP192Component::SetSleep(void)
         {
-            Write1Byte(0xB8, 0xA0);
+            SetSleep(&AXP192_DEFAULT_SLEEP_PROFILE);
         }
 
-        uint32_t AXP192Component::GetCoulombChargeData(void)
+        void AXP192Component::SetSleep(const AXP192SleepProfile *profile)
         {
-            return Read32bit(0xB0);
+            BeginWriteBatch();
+            UpdateBits(0x31, (1 << 3), (1 << 3));  // Power off voltag 3.0v
+            UpdateBits(0x90, 0x07, 0x07);          // GPIO1 floating
+            // The coulomb counter and the APS low voltage warning keep their ADCs whatever the profile says
+            uint16_t channels = profile->adc_channels | AdcIdleChannels();
+            Write1Byte(0x82, channels >> 8);
+            Write1Byte(0x83, channels & 0xff);
+            UpdateBits(0x12, 0x5E, profile->rails); // Disable the outputs the profile doesn't keep, DCDC1 stays
+            if (profile->charge_current >= 0)
+            {
+                SetChargeCurrent(profile->charge_current);
+            }
+            if (profile->irq_mask >= 0)
+            {
+                uint8_t enables[AXP192_IRQ_ENABLE_REGISTER_COUNT];
+                for (uint8_t i = 0; i < AXP192_IRQ_ENABLE_REGISTER_COUNT; i++)
+                {
+                    enables[i] = (profile->irq_mask >> (32 - 8 * i)) & 0xff;
+                }
+                WriteIrqEnables(enables);
+            }
+            if (profile->wake_on_irq)
+            {
+                // A latched event would hold IRQ low and wake us straight away
+                for (uint8_t i = 0; i < 4; i++)
+                {
+                    Write1Byte(0x44 + i, 0xff);
+                }
+            }
+            FlushWriteBatch();
         }
 
-        uint32_t AXP192Component::GetCoulombDischargeData(void)
+        bool AXP192Component::ReadIrqEnables(uint8_t *enables)
         {
-            return Read32bit(0xB4);
+            // 0x40..0x43 in one read, 0x4A on its own
+            return ReadBytes(0x40, enables, 4) && ReadBytes(0x4A, &enables[4], 1);
         }
 
-        float AXP192Component::GetCoulombData(void)
+        void AXP192Component::WriteIrqEnables(const uint8_t *enables)
         {
-            uint32_t coin = 0;
-            uint32_t coout = 0;
-
-            coin = GetCoulombChargeData();
-            coout = GetCoulombDischargeData();
+            for (uint8_t i = 0; i < AXP192_IRQ_ENABLE_REGISTER_COUNT; i++)
+            {
+                Write1Byte(AXP192_IRQ_ENABLE_REGISTERS[i], enables[i]);
+            }
+        }
 
-            // c = 65536 * current_LSB * (coin - coout) / 3600 / ADC rate
-            // Adc rate can be read from 84H ,change this variable if you change the ADC reate
-            float ccc = 65536 * 0.5 * (coin - coout) / 3600.0 / 25.0;
-            return ccc;
+        const AXP192SleepProfile *AXP192Component::find_sleep_profile(const char *name) const
+        {
+            for (const auto &profile : this->sleep_profiles_)
+            {
+                if (strcmp(profile.name, name) == 0)
+                    return &profile;
+            }
+            ESP_LOGW(TAG, "Unknown sleep profile '%s', using the default", name);
+            return nullptr;
         }
-        //----------coulomb_end_at_here----------
 
-        void AXP192Component::SetSleep(void)
+        void AXP192Component::ArmWakeSources(const AXP192SleepProfile *profile)
         {
-            Write1Byte(0x31, Read8bit(0x31) | (1 << 3)); // Power off voltag 3.0v
-            Write1Byte(0x90, Read8bit(0x90) | 0x07);     // GPIO1 floating
-            Write1Byte(0x82, 0x00);                      // Disable ADCs
-            Write1Byte(0x12, Read8bit(0x12) & 0xA1);     // Disable all outputs but DCDC1
+            esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_ALL);
+            if (profile->wake_on_irq && this->irq_pin_ != nullptr)
+            {
+                // The IRQ output is open drain and active low
+                esp_sleep_enable_ext0_wakeup((gpio_num_t) this->irq_pin_->get_pin(), 0);
+            }
+            if (profile->wake_pins != 0)
+            {
+                esp_sleep_enable_ext1_wakeup(profile->wake_pins,
+                                             profile->wake_any_high ? ESP_EXT1_WAKEUP_ANY_HIGH : ESP_EXT1_WAKEUP_ALL_LOW);
+            }
         }
 
         // -- sleep
-        void AXP192Component::DeepSleep(uint64_t time_in_us)
+        void AXP192Component::DeepSleep(uint64_t time_in_us, const AXP192SleepProfile *profile)
         {
-            SetSleep();
-            esp_sleep_enable_ext0_wakeup((gpio_num_t)37, 0 /* LOW */);
-            if (time_in_us > 0)
+            if (profile == nullptr)
             {
-                esp_sleep_enable_timer_wakeup(time_in_us);
+                profile = &AXP192_DEFAULT_SLEEP_PROFILE;
             }
-            else
+            ESP_LOGD(TAG, "Deep sleep, profile %s", profile->name);
+            if (this->fuel_gauge_ready_)
+            {
+                // Leave an up to date fuel gauge snapshot in RTC memory
+                RebaseFuelGauge();
+            }
+            SaveSleepState();
+            wake_rtc.irq_magic = 0;
+            if (profile->irq_mask >= 0 && ReadIrqEnables(wake_rtc.irq_enables))
             {
-                esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_TIMER);
+                wake_rtc.irq_magic = AXP192_WAKE_MAGIC;
             }
-            (time_in_us == 0) ? esp_deep_sleep_start() : esp_deep_sleep(time_in_us);
+            SetSleep(profile);
+            SaveSleptState();
+            ArmWakeSources(profile);
+            if (time_in_us > 0)
+            {
+                esp_sleep_enable_timer_wakeup(time_in_us);
+            }
+            esp_deep_sleep_start();
         }
 
-        void AXP192Component::LightSleep(uint64_t time_in_us)
+        void AXP192Component::LightSleep(uint64_t time_in_us, const AXP192SleepProfile *profile)
         {
+            if (profile == nullptr)
+            {
+                profile = &AXP192_DEFAULT_SLEEP_PROFILE;
+            }
+            ESP_LOGD(TAG, "Light sleep, profile %s", profile->name);
+
+            // Execution resumes here, so remember what the profile changes and put it back afterwards
+            uint8_t awake[AXP192_SLEEP_REGISTER_COUNT];
+            bool restore = true;
+            for (uint8_t i = 0; i < AXP192_SLEEP_REGISTER_COUNT; i++)
+            {
+                restore &= ReadByte(AXP192_SLEEP_REGISTERS[i], &awake[i]);
+            }
+            uint8_t irq_enables[AXP192_IRQ_ENABLE_REGISTER_COUNT];
+            if (profile->irq_mask >= 0)
+            {
+                restore &= ReadIrqEnables(irq_enables);
+            }
+
+            SetSleep(profile);
+            ArmWakeSources(profile);
             if (time_in_us > 0)
             {
                 esp_sleep_enable_timer_wakeup(time_in_us);
             }
-            else
+            esp_light_sleep_start();
+
+            if (!restore)
+            {
+                ESP_LOGW(TAG, "Register state unknown before light sleep, running full init");
+                reg_cache_valid_ = 0;
+                begin();
+                return;
+            }
+            BeginWriteBatch();
+            for (uint8_t i = 0; i < AXP192_SLEEP_REGISTER_COUNT; i++)
             {
-                esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_TIMER);
+                Write1Byte(AXP192_SLEEP_REGISTERS[i], awake[i]);
             }
-            esp_light_sleep_start();
+            if (profile->irq_mask >= 0)
+            {
+                WriteIrqEnables(irq_enables);
+            }
+            FlushWriteBatch();
         }
 
         // 0 not press, 0x01 long press, 0x02 press
@@ -540,87 +2385,74 @@ namespace esphome
 
         float AXP192Component::GetBatVoltage()
         {
-            float ADCLSB = 1.1 / 1000.0;
-            uint16_t ReData = Read12Bit(0x78);
-            return ReData * ADCLSB;
+            return ReadQuantity(QUANTITY_BAT_VOLTAGE, 0.001f);
         }
 
         float AXP192Component::GetBatCurrent()
         {
-            float ADCLSB = 0.5;
-            uint16_t CurrentIn = Read13Bit(0x7A);
-            uint16_t CurrentOut = Read13Bit(0x7C);
-            return (CurrentIn - CurrentOut) * ADCLSB;
+            return ReadQuantity(QUANTITY_BAT_CURRENT, 1.0f);
         }
 
         float AXP192Component::GetVinVoltage()
         {
-            float ADCLSB = 1.7 / 1000.0;
-            uint16_t ReData = Read12Bit(0x56);
-            return ReData * ADCLSB;
+            return ReadQuantity(QUANTITY_VIN_VOLTAGE, 0.001f);
         }
 
         float AXP192Component::GetVinCurrent()
         {
-            float ADCLSB = 0.625;
-            uint16_t ReData = Read12Bit(0x58);
-            return ReData * ADCLSB;
+            return ReadQuantity(QUANTITY_VIN_CURRENT, 1.0f);
         }
 
         float AXP192Component::GetVBusVoltage()
         {
-            float ADCLSB = 1.7 / 1000.0;
-            uint16_t ReData = Read12Bit(0x5A);
-            return ReData * ADCLSB;
+            return ReadQuantity(QUANTITY_VBUS_VOLTAGE, 0.001f);
         }
 
         float AXP192Component::GetVBusCurrent()
         {
-            float ADCLSB = 0.375;
-            uint16_t ReData = Read12Bit(0x5C);
-            return ReData * ADCLSB;
+            return ReadQuantity(QUANTITY_VBUS_CURRENT, 1.0f);
         }
 
         float AXP192Component::GetTempInAXP192()
         {
-            float ADCLSB = 0.1;
-            const float OFFSET_DEG_C = -144.7;
-            uint16_t ReData = Read12Bit(0x5E);
-            return OFFSET_DEG_C + ReData * ADCLSB;
+            return ReadQuantity(QUANTITY_TEMPERATURE, 0.001f);
         }
 
         float AXP192Component::GetBatPower()
         {
+            // 24 bit product of the battery voltage and current LSBs, not an ADC_DESCRIPTORS quantity
             float VoltageLSB = 1.1;
             float CurrentLCS = 0.5;
-            uint32_t ReData = Read24bit(0x70);
+            uint32_t ReData;
+            if (!Read24bit(0x70, &ReData))
+                return NAN;
             return VoltageLSB * CurrentLCS * ReData / 1000.0;
         }
 
         float AXP192Component::GetBatChargeCurrent()
         {
-            float ADCLSB = 0.5;
-            uint16_t ReData = Read13Bit(0x7A);
-            return ReData * ADCLSB;
+            return ReadQuantity(QUANTITY_BAT_CHARGE_CURRENT, 1.0f);
         }
 
         float AXP192Component::GetAPSVoltage()
         {
-            float ADCLSB = 1.4 / 1000.0;
-            uint16_t ReData = Read12Bit(0x7E);
-            return ReData * ADCLSB;
+            return ReadQuantity(QUANTITY_APS_VOLTAGE, 0.001f);
         }
 
         float AXP192Component::GetBatCoulombInput()
         {
-            uint32_t ReData = Read32bit(0xB0);
-            return ReData * 65536 * 0.5 / 3600 / 25.0;
+            uint32_t ReData;
+            if (!Read32bit(0xB0, &ReData))
+                return NAN;
+            return ReData * CoulombMahPerCount();
         }
 
         float AXP192Component::GetBatCoulombOut()
         {
-            uint32_t ReData = Read32bit(0xB4);
-            return ReData * 65536 * 0.5 / 3600 / 25.0;
+            uint32_t ReData;
+            if (!Read32bit(0xB4, &ReData))
+                return NAN;
+            return ReData * CoulombMahPerCount();
         }
 
         void AXP192Component::SetCoulombClear()
@@ -630,97 +2462,84 @@ namespace esphome
 
         void AXP192Component::SetLDO2(bool State)
         {
-            ESP_LOGD(TAG, "SetLDO2(): %s", State ? "true" : "false");
-
-            uint8_t buf = Read8bit(0x12);
-            if (State == true)
-            {
-                buf = (1 << 2) | buf;
-            }
-            else
-            {
-                buf = ~(1 << 2) & buf;
-            }
-            Write1Byte(0x12, buf);
+            SetRailEnabled(RAIL_LDO2, State);
         }
 
         void AXP192Component::SetLDO3(bool State)
         {
-            ESP_LOGD(TAG, "SetLDO3(): %s", State ? "true" : "false");
+            SetRailEnabled(RAIL_LDO3, State);
+        }
 
-            uint8_t buf = Read8bit(0x12);
-            if (State == true)
-            {
-                buf = (1 << 3) | buf;
-            }
-            else
-            {
-                buf = ~(1 << 3) & buf;
-            }
-            Write1Byte(0x12, buf);
+        const AXP192RailDescriptor &AXP192Component::GetRailDescriptor(AXP192Rail rail)
+        {
+            return AXP192_RAILS[rail];
+        }
+
+        void AXP192Component::SetRailEnabled(AXP192Rail rail, bool enabled)
+        {
+            const AXP192RailDescriptor &d = AXP192_RAILS[rail];
+            ESP_LOGV(TAG, "%s %s", d.name, enabled ? "on" : "off");
+            UpdateBits(d.enable_reg, d.enable_mask, enabled ? d.enable_on : d.enable_off);
+        }
+
+        bool AXP192Component::GetRailEnabled(AXP192Rail rail)
+        {
+            const AXP192RailDescriptor &d = AXP192_RAILS[rail];
+            uint8_t value;
+            return ReadByte(d.enable_reg, &value) && (value & d.enable_mask) == d.enable_on;
+        }
+
+        void AXP192Component::SetRailVoltage(AXP192Rail rail, uint16_t millivolts)
+        {
+            const AXP192RailDescriptor &d = AXP192_RAILS[rail];
+            uint8_t code = (clamp(millivolts, d.min_mv, d.max_mv) - d.min_mv) / d.step_mv;
+            ESP_LOGV(TAG, "%s %u mV", d.name, (unsigned) (d.min_mv + code * d.step_mv));
+            UpdateBits(d.voltage_reg, d.voltage_mask, code << d.voltage_shift);
+        }
+
+        uint16_t AXP192Component::GetRailVoltage(AXP192Rail rail)
+        {
+            const AXP192RailDescriptor &d = AXP192_RAILS[rail];
+            uint8_t value;
+            if (!ReadByte(d.voltage_reg, &value))
+                return 0;
+            return d.min_mv + ((value & d.voltage_mask) >> d.voltage_shift) * d.step_mv;
         }
 
         void AXP192Component::SetChargeCurrent(uint8_t current)
         {
-            uint8_t buf = Read8bit(0x33);
-            buf = (buf & 0xf0) | (current & 0x07);
-            Write1Byte(0x33, buf);
+            UpdateBits(0x33, 0x0f, current & 0x07);
         }
 
         void AXP192Component::PowerOff()
         {
-            Write1Byte(0x32, Read8bit(0x32) | 0x80);
+            UpdateBits(0x32, 0x80, 0x80);
         }
 
         void AXP192Component::SetAdcState(bool state)
         {
-            Write1Byte(0x82, state ? 0xff : 0x00);
+            adc_powered_ = state;
+            uint16_t channels = state ? adc_channels_ : AdcIdleChannels();
+            BeginWriteBatch();
+            Write1Byte(0x82, channels >> 8);
+            Write1Byte(0x83, channels & 0xff);
+            FlushWriteBatch();
         }
 
-        std::string AXP192Component::GetStartupReason()
+        const char *AXP192Component::GetStartupReason()
         {
             esp_reset_reason_t reset_reason = ::esp_reset_reason();
             if (reset_reason == ESP_RST_DEEPSLEEP)
             {
                 esp_sleep_source_t wake_reason = esp_sleep_get_wakeup_cause();
-                if (wake_reason == ESP_SLEEP_WAKEUP_EXT0)
-                    return "ESP_SLEEP_WAKEUP_EXT0";
-                if (wake_reason == ESP_SLEEP_WAKEUP_EXT0)
-                    return "ESP_SLEEP_WAKEUP_EXT0";
-                if (wake_reason == ESP_SLEEP_WAKEUP_EXT1)
-                    return "ESP_SLEEP_WAKEUP_EXT1";
-                if (wake_reason == ESP_SLEEP_WAKEUP_TIMER)
-                    return "ESP_SLEEP_WAKEUP_TIMER";
-                if (wake_reason == ESP_SLEEP_WAKEUP_TOUCHPAD)
-                    return "ESP_SLEEP_WAKEUP_TOUCHPAD";
-                if (wake_reason == ESP_SLEEP_WAKEUP_ULP)
-                    return "ESP_SLEEP_WAKEUP_ULP";
-                if (wake_reason == ESP_SLEEP_WAKEUP_GPIO)
-                    return "ESP_SLEEP_WAKEUP_GPIO";
-                if (wake_reason == ESP_SLEEP_WAKEUP_UART)
-                    return "ESP_SLEEP_WAKEUP_UART";
-                return std::string{"WAKEUP_UNKNOWN_REASON"};
-            }
-
-            if (reset_reason == ESP_RST_UNKNOWN)
-                return "ESP_RST_UNKNOWN";
-            if (reset_reason == ESP_RST_POWERON)
-                return "ESP_RST_POWERON";
-            if (reset_reason == ESP_RST_SW)
-                return "ESP_RST_SW";
-            if (reset_reason == ESP_RST_PANIC)
-                return "ESP_RST_PANIC";
-            if (reset_reason == ESP_RST_INT_WDT)
-                return "ESP_RST_INT_WDT";
-            if (reset_reason == ESP_RST_TASK_WDT)
-                return "ESP_RST_TASK_WDT";
-            if (reset_reason == ESP_RST_WDT)
-                return "ESP_RST_WDT";
-            if (reset_reason == ESP_RST_BROWNOUT)
-                return "ESP_RST_BROWNOUT";
-            if (reset_reason == ESP_RST_SDIO)
-                return "ESP_RST_SDIO";
-            return std::string{"RESET_UNKNOWN_REASON"};
+                if (wake_reason < sizeof(AXP192_WAKEUP_REASONS) / sizeof(AXP192_WAKEUP_REASONS[0]))
+                    return AXP192_WAKEUP_REASONS[wake_reason];
+                return "WAKEUP_UNKNOWN_REASON";
+            }
+
+            if (reset_reason < sizeof(AXP192_RESET_REASONS) / sizeof(AXP192_RESET_REASONS[0]))
+                return AXP192_RESET_REASONS[reset_reason];
+            return "RESET_UNKNOWN_REASON";
         }
 
     }
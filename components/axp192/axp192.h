@@ -1,9 +1,19 @@
 #ifndef __AXP192_H__
 #define __AXP192_H__
 
+#include "esphome/core/defines.h"
 #include "esphome/core/component.h"
+#include "esphome/core/gpio.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/preferences.h"
 #include "esphome/components/sensor/sensor.h"
 #include "esphome/components/i2c/i2c.h"
+#ifdef USE_BINARY_SENSOR
+#include "esphome/components/binary_sensor/binary_sensor.h"
+#endif
+#include <cmath>
+#include <vector>
 
 namespace esphome
 {
@@ -36,33 +46,499 @@ namespace esphome
             CURRENT_700MA,
         };
 
+        // Events decoded from the IRQ status registers 0x44..0x47
+        enum AXP192Event : uint8_t
+        {
+            EVENT_BUTTON_SHORT_PRESS = 0,
+            EVENT_BUTTON_LONG_PRESS,
+            EVENT_VBUS_INSERT,
+            EVENT_VBUS_REMOVE,
+            EVENT_LOW_BATTERY,
+            EVENT_CHARGE_START,
+            EVENT_CHARGE_DONE,
+            EVENT_COUNT,
+        };
+
+        // Channels published by update()
+        enum AXP192Channel : uint8_t
+        {
+            CHANNEL_BAT_VOLTAGE = 0,
+            CHANNEL_BAT_CURRENT,
+            CHANNEL_VBUS_VOLTAGE,
+            CHANNEL_VBUS_CURRENT,
+            CHANNEL_VIN_CURRENT,
+            CHANNEL_TEMPERATURE,
+            CHANNEL_COUNT,
+        };
+
+        // Steps of the acquisition started by update() and advanced from loop()
+        enum AXP192UpdateState : uint8_t
+        {
+            UPDATE_IDLE = 0,
+            UPDATE_ADC_WAKE,
+            UPDATE_ADC_SETTLE,
+            UPDATE_READ,
+            UPDATE_BATTERY_LEVEL,
+            UPDATE_RUNTIME,
+            UPDATE_ENERGY,
+            UPDATE_CHARGE,
+            UPDATE_HISTORY,
+            UPDATE_PUBLISH,
+            UPDATE_IRQ,
+            UPDATE_DIAGNOSTICS,
+        };
+
+        // Energy counters, integrated from the ADC power readings
+        enum AXP192EnergyCounter : uint8_t
+        {
+            ENERGY_BAT_CHARGE = 0,
+            ENERGY_BAT_DISCHARGE,
+            ENERGY_VBUS,
+            ENERGY_VIN,
+            ENERGY_COUNT,
+        };
+
+        // Persisted energy totals in nanojoules (µW * ms), the highest sequence of all slots wins
+        struct AXP192EnergyRecord
+        {
+            uint32_t sequence;
+            uint64_t nanojoules[ENERGY_COUNT];
+        };
+
+        // Flash slots written in rotation
+        static const uint8_t AXP192_ENERGY_SLOTS = 4;
+
+        // History log block, see README: keyframe of absolute values followed by int8 deltas
+        static const uint8_t AXP192_HISTORY_BLOCK_SIZE = 64;
+        static const uint8_t AXP192_HISTORY_HEADER_SIZE = 14;
+        static const uint8_t AXP192_HISTORY_RECORD_SIZE = 3;
+        static const uint8_t AXP192_HISTORY_MAGIC = 0xA1;
+
+        // Trace points, one record each when AXP192_TRACE_RECORDS is defined
+        enum AXP192TraceKind : uint8_t
+        {
+            // reg: first register, value: transfer time in us including retries
+            TRACE_READ = 0,
+            TRACE_WRITE,
+            // reg: AXP192Quantity, value: raw ADC result (two's complement for differences)
+            TRACE_DECODE,
+            // reg: AXP192Channel, value: time in the publish callbacks in us
+            TRACE_PUBLISH,
+            // reg: AXP192UpdateState that ran, value: its duration in us
+            TRACE_STEP,
+            TRACE_KIND_COUNT,
+        };
+
+        struct AXP192TraceRecord
+        {
+            uint32_t time_us;
+            uint8_t kind;
+            uint8_t reg;
+            uint16_t value;
+        };
+        static_assert(sizeof(AXP192TraceRecord) == 8, "trace records are 8 bytes");
+
+        // Without AXP192_TRACE_RECORDS the trace points expand to nothing, their arguments are never evaluated
+#ifdef AXP192_TRACE_RECORDS
+#define AXP192_TRACE_BEGIN(start) uint32_t start = micros()
+#define AXP192_TRACE(kind, reg, value) this->Trace(kind, reg, value)
+        // Microseconds since start, saturated to the record's value field
+        inline uint16_t AXP192TraceSince(uint32_t start)
+        {
+            uint32_t elapsed = micros() - start;
+            return elapsed > 0xFFFF ? 0xFFFF : elapsed;
+        }
+#else
+#define AXP192_TRACE_BEGIN(start)
+#define AXP192_TRACE(kind, reg, value)
+#endif
+
+        // Switchable outputs, one AXP192_RAILS descriptor each
+        enum AXP192Rail : uint8_t
+        {
+            RAIL_DCDC1 = 0,
+            RAIL_DCDC2,
+            RAIL_DCDC3,
+            RAIL_LDO2,
+            RAIL_LDO3,
+            RAIL_LDOIO0,
+            RAIL_COUNT,
+        };
+
+        struct AXP192RailDescriptor
+        {
+            const char *name;
+            // Enable field: on and off values within the mask
+            uint8_t enable_reg;
+            uint8_t enable_mask;
+            uint8_t enable_on;
+            uint8_t enable_off;
+            // Voltage field: min_mv + code * step_mv, up to max_mv
+            uint8_t voltage_reg;
+            uint8_t voltage_mask;
+            uint8_t voltage_shift;
+            uint16_t min_mv;
+            uint16_t step_mv;
+            uint16_t max_mv;
+        };
+
+        // Running mean/min/max of one channel over an update interval, without storing samples
+        struct AXP192Aggregate
+        {
+            float sum{0.0f};
+            float min{NAN};
+            float max{NAN};
+            uint32_t count{0};
+
+            void add(float value)
+            {
+                sum += value;
+                if (count == 0 || value < min)
+                    min = value;
+                if (count == 0 || value > max)
+                    max = value;
+                count++;
+            }
+            float mean() const { return count == 0 ? NAN : sum / count; }
+            void reset() { *this = AXP192Aggregate(); }
+        };
+
+        // ADC enable bits: the high byte maps to register 0x82, the low byte to 0x83
+        enum AXP192AdcChannel : uint16_t
+        {
+            ADC_BAT_VOLTAGE = 0x8000,
+            ADC_BAT_CURRENT = 0x4000,
+            ADC_VIN_VOLTAGE = 0x2000,
+            ADC_VIN_CURRENT = 0x1000,
+            ADC_VBUS_VOLTAGE = 0x0800,
+            ADC_VBUS_CURRENT = 0x0400,
+            ADC_APS_VOLTAGE = 0x0200,
+            ADC_TS_PIN = 0x0100,
+            ADC_TEMPERATURE = 0x0080,
+        };
+
+        // Quantities decoded from the ADC result registers, one AXP192_ADC_DESCRIPTORS entry each
+        enum AXP192Quantity : uint8_t
+        {
+            QUANTITY_VIN_VOLTAGE = 0,
+            QUANTITY_VIN_CURRENT,
+            QUANTITY_VBUS_VOLTAGE,
+            QUANTITY_VBUS_CURRENT,
+            QUANTITY_TEMPERATURE,
+            QUANTITY_TS_VOLTAGE,
+            QUANTITY_BAT_VOLTAGE,
+            QUANTITY_BAT_CHARGE_CURRENT,
+            QUANTITY_BAT_DISCHARGE_CURRENT,
+            QUANTITY_BAT_CURRENT,
+            QUANTITY_APS_VOLTAGE,
+            QUANTITY_COUNT,
+        };
+
+        // How one quantity is decoded into integer milli-units (mV, mA, m°C)
+        struct AXP192AdcDescriptor
+        {
+            // High byte of the result, the low bits follow in the next register
+            uint8_t reg;
+            // 12 or 13 bit result
+            uint8_t bits;
+            // Result of the same width subtracted from this one, 0 for none
+            uint8_t minus_reg;
+            // LSB in milli-units as a fraction
+            int16_t lsb_num;
+            int16_t lsb_den;
+            int32_t offset;
+        };
+
+        // ADC sample rate, bits 7:6 of register 0x84
+        enum AXP192AdcRate : uint8_t
+        {
+            ADC_RATE_25HZ = 0,
+            ADC_RATE_50HZ,
+            ADC_RATE_100HZ,
+            ADC_RATE_200HZ,
+        };
+
+        // Per-model hardware layout. The model is fixed in YAML, so the code generator defines
+        // AXP192_MODEL and only the selected specialisation ends up in the firmware.
+        template <AXP192Model M>
+        struct AXP192ModelTraits;
+
+        template <>
+        struct AXP192ModelTraits<AXP192_M5STICKC>
+        {
+            static constexpr const char *NAME = "M5StickC";
+            // Rails (bits of 0x12) left off by begin()
+            static constexpr uint8_t DISABLED_RAILS = 0;
+            static constexpr bool DISABLE_RTC = false;
+            // Boot-time rail voltages: DCDC3 (0x27) and LDO2/LDO3 (0x28)
+            static constexpr bool SET_DCDC3_VOLTAGE = false;
+            static constexpr bool SET_LDO23_VOLTAGE = true;
+            // Charger, PEK and VBUS setup
+            static constexpr bool BATTERY_SETUP = true;
+            // Backlight voltage field, its usable code range and the 0x12 rail bit switched off at zero brightness.
+            // LDO2 steps 100mV from 1.8V, codes 7..12 are 2.5V..3.0V: only 6 steps, above 3.0V overdrives the LED
+            static constexpr uint8_t BACKLIGHT_REG = 0x28;
+            static constexpr uint8_t BACKLIGHT_MASK = 0xf0;
+            static constexpr uint8_t BACKLIGHT_SHIFT = 4;
+            static constexpr uint8_t BACKLIGHT_MIN = 7;
+            static constexpr uint8_t BACKLIGHT_MAX = 12;
+            static constexpr uint8_t BACKLIGHT_RAIL = (1 << 2);
+            // Wait after begin() raised a rail or changed its voltage, before dependent components are set up
+            static constexpr uint16_t RAIL_SETTLE_MS = 20;
+            // ext1 wake pins (all low) armed by the default sleep profile: button A on GPIO37
+            static constexpr uint64_t SLEEP_WAKE_PINS = (1ULL << 37);
+        };
+
+        template <>
+        struct AXP192ModelTraits<AXP192_M5CORE2>
+        {
+            static constexpr const char *NAME = "M5Core2";
+            // LDO3 drives the vibration motor
+            static constexpr uint8_t DISABLED_RAILS = (1 << 3);
+            static constexpr bool DISABLE_RTC = false;
+            static constexpr bool SET_DCDC3_VOLTAGE = true;
+            static constexpr bool SET_LDO23_VOLTAGE = true;
+            static constexpr bool BATTERY_SETUP = true;
+            // DCDC3 steps 25mV from 0.7V, codes 72..104 are 2.5V..3.3V. DCDC3 only feeds the backlight, so it goes off at zero
+            static constexpr uint8_t BACKLIGHT_REG = 0x27;
+            static constexpr uint8_t BACKLIGHT_MASK = 0x7f;
+            static constexpr uint8_t BACKLIGHT_SHIFT = 0;
+            static constexpr uint8_t BACKLIGHT_MIN = 72;
+            static constexpr uint8_t BACKLIGHT_MAX = 104;
+            static constexpr uint8_t BACKLIGHT_RAIL = (1 << 1);
+            static constexpr uint16_t RAIL_SETTLE_MS = 100;
+            static constexpr uint64_t SLEEP_WAKE_PINS = 0;
+        };
+
+        template <>
+        struct AXP192ModelTraits<AXP192_M5TOUGH>
+        {
+            static constexpr const char *NAME = "M5Tough";
+            static constexpr uint8_t DISABLED_RAILS = 0;
+            static constexpr bool DISABLE_RTC = false;
+            static constexpr bool SET_DCDC3_VOLTAGE = true;
+            static constexpr bool SET_LDO23_VOLTAGE = true;
+            static constexpr bool BATTERY_SETUP = true;
+            static constexpr uint8_t BACKLIGHT_REG = 0x27;
+            static constexpr uint8_t BACKLIGHT_MASK = 0x7f;
+            static constexpr uint8_t BACKLIGHT_SHIFT = 0;
+            static constexpr uint8_t BACKLIGHT_MIN = 72;
+            static constexpr uint8_t BACKLIGHT_MAX = 104;
+            // The backlight enable is LDO3, as the M5Tough driver switches it, while the level is DCDC3 like the Core2
+            static constexpr uint8_t BACKLIGHT_RAIL = (1 << 3);
+            // Display and touch controller need their rails stable before they are set up
+            static constexpr uint16_t RAIL_SETTLE_MS = 100;
+            static constexpr uint64_t SLEEP_WAKE_PINS = 0;
+        };
+
+        template <>
+        struct AXP192ModelTraits<AXP192_TTGO_TCALL>
+        {
+            static constexpr const char *NAME = "TTGO T-Call";
+            // LDO2 is NC, LDO3 is GPS_VDD and DCDC1 is NC
+            static constexpr uint8_t DISABLED_RAILS = (1 << 3) | (1 << 2) | (1 << 0);
+            static constexpr bool DISABLE_RTC = true;
+            static constexpr bool SET_DCDC3_VOLTAGE = false;
+            static constexpr bool SET_LDO23_VOLTAGE = false;
+            static constexpr bool BATTERY_SETUP = false;
+            static constexpr uint8_t BACKLIGHT_REG = 0;
+            static constexpr uint8_t BACKLIGHT_MASK = 0;
+            static constexpr uint8_t BACKLIGHT_SHIFT = 0;
+            static constexpr uint8_t BACKLIGHT_MIN = 0;
+            static constexpr uint8_t BACKLIGHT_MAX = 0;
+            static constexpr uint8_t BACKLIGHT_RAIL = 0;
+            static constexpr uint16_t RAIL_SETTLE_MS = 20;
+            static constexpr uint64_t SLEEP_WAKE_PINS = 0;
+        };
+
+        template <>
+        struct AXP192ModelTraits<AXP192_LILYGO_TCAMINI>
+        {
+            static constexpr const char *NAME = "LilyGO T-Camera Mini";
+            static constexpr uint8_t DISABLED_RAILS = 0;
+            static constexpr bool DISABLE_RTC = false;
+            static constexpr bool SET_DCDC3_VOLTAGE = false;
+            static constexpr bool SET_LDO23_VOLTAGE = false;
+            static constexpr bool BATTERY_SETUP = true;
+            static constexpr uint8_t BACKLIGHT_REG = 0;
+            static constexpr uint8_t BACKLIGHT_MASK = 0;
+            static constexpr uint8_t BACKLIGHT_SHIFT = 0;
+            static constexpr uint8_t BACKLIGHT_MIN = 0;
+            static constexpr uint8_t BACKLIGHT_MAX = 0;
+            static constexpr uint8_t BACKLIGHT_RAIL = 0;
+            static constexpr uint16_t RAIL_SETTLE_MS = 20;
+            static constexpr uint64_t SLEEP_WAKE_PINS = 0;
+        };
+
+        // What stays powered and what can wake the ESP while sleeping
+        struct AXP192SleepProfile
+        {
+            const char *name;
+            // Bits of 0x12 left on, DCDC1 (the ESP supply) always stays up
+            uint8_t rails;
+            // ADC enables (0x82/0x83) kept while asleep
+            uint16_t adc_channels;
+            // ext1 wake pins and whether any high or all low wakes
+            uint64_t wake_pins;
+            bool wake_any_high;
+            // Wake on the PMIC IRQ line through ext0, needs irq_pin
+            bool wake_on_irq;
+            // Charge current while asleep, -1 leaves it unchanged
+            int8_t charge_current;
+            // IRQ enables while asleep, 0x40..0x43 in bits 39..8 and 0x4A in bits 7..0, -1 leaves them unchanged
+            int64_t irq_mask;
+        };
+
+#ifndef AXP192_MODEL
+#error "AXP192_MODEL is not defined, it is set by the axp192 sensor platform"
+#endif
+        using ModelTraits = AXP192ModelTraits<AXP192_MODEL>;
+
+        // ADC result registers are laid out contiguously and can be fetched in one burst
+        static const uint8_t AXP192_ADC_BLOCK_START = 0x56;
+        static const uint8_t AXP192_ADC_BLOCK_END = 0x7F;
+        static const uint8_t AXP192_ADC_BLOCK_SIZE = AXP192_ADC_BLOCK_END - AXP192_ADC_BLOCK_START + 1;
+
+        // Number of control registers mirrored in RAM, see AXP192_CACHED_REGISTERS in axp192.cpp
+        static const uint8_t AXP192_CACHED_REGISTER_COUNT = 17;
+
+        // Failed transactions are retried this many times, waiting AXP192_I2C_BACKOFF_US << attempt in between
+        static const uint8_t AXP192_I2C_RETRIES = 3;
+        static const uint32_t AXP192_I2C_BACKOFF_US = 100;
+
+        // Transaction latency histogram: bucket n counts latencies below AXP192_LATENCY_BUCKET_US << n, the last one the rest
+        static const uint8_t AXP192_LATENCY_BUCKETS = 8;
+        static const uint32_t AXP192_LATENCY_BUCKET_US = 100;
+
+        struct AXP192I2CStats
+        {
+            uint32_t transactions{0};
+            uint32_t failures{0};
+            uint32_t retries{0};
+            uint32_t latency_max{0};
+            uint32_t latency_histogram[AXP192_LATENCY_BUCKETS]{};
+        };
+
+        // APS low voltage IRQ status bits in 0x47 (least significant byte of the IRQ word): level 1 and level 2
+        static const uint32_t AXP192_IRQ_APS_WARNING = (1UL << 1);
+        static const uint32_t AXP192_IRQ_APS_SHUTDOWN = (1UL << 0);
+
+        // Maximum register/value pairs sent in one multi-register write transaction
+        static const uint8_t AXP192_WRITE_BATCH_MAX = 32;
+
         class AXP192Component : public PollingComponent, public i2c::I2CDevice
         {
         public:
-            void set_model(AXP192Model model) { this->model_ = model; }
             void set_charge_current(AXP192ChargeCurrent charge_current) { this->charge_current_ = charge_current; }
             void set_batterylevel_sensor(sensor::Sensor *batterylevel_sensor) { batterylevel_sensor_ = batterylevel_sensor; }
-            void set_batteryvoltage_sensor(sensor::Sensor *batteryvoltage_sensor) { batteryvoltage_sensor_ = batteryvoltage_sensor; }
-            void set_batterycurrent_sensor(sensor::Sensor *batterycurrent_sensor) { batterycurrent_sensor_ = batterycurrent_sensor; }
-            void set_vbusvoltage_sensor(sensor::Sensor *vbusvoltage_sensor) { vbusvoltage_sensor_ = vbusvoltage_sensor; }
-            void set_vbuscurrent_sensor(sensor::Sensor *vbuscurrent_sensor) { vbuscurrent_sensor_ = vbuscurrent_sensor; }
-            void set_vincurrent_sensor(sensor::Sensor *vincurrent_sensor) { vincurrent_sensor_ = vincurrent_sensor; }
-            void set_temperature_sensor(sensor::Sensor *temperature_sensor) { temperature_sensor_ = temperature_sensor; }
+            void set_batteryvoltage_sensor(sensor::Sensor *batteryvoltage_sensor) { channel_sensors_[CHANNEL_BAT_VOLTAGE] = batteryvoltage_sensor; }
+            void set_batterycurrent_sensor(sensor::Sensor *batterycurrent_sensor) { channel_sensors_[CHANNEL_BAT_CURRENT] = batterycurrent_sensor; }
+            void set_vbusvoltage_sensor(sensor::Sensor *vbusvoltage_sensor) { channel_sensors_[CHANNEL_VBUS_VOLTAGE] = vbusvoltage_sensor; }
+            void set_vbuscurrent_sensor(sensor::Sensor *vbuscurrent_sensor) { channel_sensors_[CHANNEL_VBUS_CURRENT] = vbuscurrent_sensor; }
+            void set_vincurrent_sensor(sensor::Sensor *vincurrent_sensor) { channel_sensors_[CHANNEL_VIN_CURRENT] = vincurrent_sensor; }
+            void set_temperature_sensor(sensor::Sensor *temperature_sensor) { channel_sensors_[CHANNEL_TEMPERATURE] = temperature_sensor; }
+            void set_channel_min_sensor(AXP192Channel channel, sensor::Sensor *min_sensor) { channel_min_sensors_[channel] = min_sensor; }
+            void set_channel_max_sensor(AXP192Channel channel, sensor::Sensor *max_sensor) { channel_max_sensors_[channel] = max_sensor; }
+            // Publish a channel on its own interval (ms) instead of every update(); 0 follows update_interval
+            void set_channel_update_interval(AXP192Channel channel, uint32_t update_interval) { channel_interval_[channel] = update_interval; }
+            // Time (us) loop() may spend advancing an acquisition before yielding
+            void set_loop_budget(uint32_t loop_budget) { loop_budget_ = loop_budget; }
+            // Worst-case loop() blocking time since the previous update, in ms
+            void set_loop_time_sensor(sensor::Sensor *loop_time_sensor) { loop_time_sensor_ = loop_time_sensor; }
+            void set_i2c_transactions_sensor(sensor::Sensor *i2c_transactions_sensor) { i2c_transactions_sensor_ = i2c_transactions_sensor; }
+            void set_i2c_failures_sensor(sensor::Sensor *i2c_failures_sensor) { i2c_failures_sensor_ = i2c_failures_sensor; }
+            void set_i2c_retries_sensor(sensor::Sensor *i2c_retries_sensor) { i2c_retries_sensor_ = i2c_retries_sensor; }
+            // Slowest transaction since the previous update, in ms
+            void set_i2c_latency_sensor(sensor::Sensor *i2c_latency_sensor) { i2c_latency_sensor_ = i2c_latency_sensor; }
+            // Sample the ADC block this often (ms) and aggregate until the next update(); 0 samples once per update
+            void set_fast_sample_interval(uint32_t fast_sample_interval) { fast_sample_interval_ = fast_sample_interval; }
+            // Power the ADCs only around each update's burst read; settle time in ms, 0 derives it from the sample rate
+            void set_adc_duty_cycle(bool adc_duty_cycle, uint32_t adc_settle_time = 0)
+            {
+                adc_duty_cycle_ = adc_duty_cycle;
+                adc_settle_time_ = adc_settle_time;
+            }
+            void set_energy_sensor(AXP192EnergyCounter counter, sensor::Sensor *energy_sensor) { energy_sensors_[counter] = energy_sensor; }
+            // Minimum time between flash writes of the energy totals, in ms
+            void set_energy_commit_interval(uint32_t energy_commit_interval) { energy_commit_interval_ = energy_commit_interval; }
+            // Adaptive charge current: step 0x33 up to ceiling while VBUS stays within budget
+            void set_charge_controller(AXP192ChargeCurrent ceiling, float vbus_current_limit, float vbus_min_voltage, float max_temperature)
+            {
+                charge_ceiling_ = ceiling;
+                charge_vbus_limit_ma_ = vbus_current_limit * 1000.0f;
+                charge_vbus_min_mv_ = vbus_min_voltage * 1000.0f;
+                charge_max_temp_mc_ = max_temperature * 1000.0f;
+                charge_controller_ = true;
+            }
+            // APS low voltage thresholds in V: warning raises EVENT_LOW_BATTERY, shutdown starts the emergency shutdown.
+            // Without an IRQ line the status is polled every poll_interval ms; the shutdown automation gets deadline ms.
+            void set_low_battery_shutdown(float warning_voltage, float shutdown_voltage, uint32_t poll_interval, uint32_t deadline, bool deep_sleep)
+            {
+                shutdown_warning_mv_ = warning_voltage * 1000.0f;
+                shutdown_mv_ = shutdown_voltage * 1000.0f;
+                shutdown_poll_interval_ = poll_interval;
+                shutdown_deadline_ = deadline;
+                shutdown_deep_sleep_ = deep_sleep;
+                shutdown_enabled_ = true;
+                irq_enable_mask_ |= AXP192_IRQ_APS_WARNING | AXP192_IRQ_APS_SHUTDOWN;
+            }
+            void set_low_battery_shutdown_profile(const char *profile) { shutdown_profile_ = profile; }
+            void add_on_low_battery_shutdown_callback(std::function<void()> &&callback)
+            {
+                shutdown_automation_ = true;
+                shutdown_callback_.add(std::move(callback));
+            }
+            // Log a battery/VBUS/temperature sample this often, the ring itself is sized by AXP192_HISTORY_BLOCKS
+            void set_history_interval(uint32_t history_interval) { history_interval_ = history_interval; }
+            // Write the history ring to the log, one block per loop iteration
+            void DumpHistory();
+            // Write the trace ring to the log, oldest record first; recording pauses until it is done
+            void DumpTrace();
+            // Battery capacity in mAh; enables the coulomb counter fuel gauge for battery_level
+            void set_battery_capacity(float battery_capacity) { battery_capacity_ = battery_capacity; }
+            // Minutes until empty or full at the smoothed battery current, needs battery_capacity
+            void set_time_to_empty_sensor(sensor::Sensor *time_to_empty_sensor) { time_to_empty_sensor_ = time_to_empty_sensor; }
+            void set_time_to_full_sensor(sensor::Sensor *time_to_full_sensor) { time_to_full_sensor_ = time_to_full_sensor; }
+#ifdef USE_BINARY_SENSOR
+            void set_vbus_binary_sensor(binary_sensor::BinarySensor *vbus_binary_sensor);
+            void set_charging_binary_sensor(binary_sensor::BinarySensor *charging_binary_sensor);
+            void set_lowbattery_binary_sensor(binary_sensor::BinarySensor *lowbattery_binary_sensor);
+            void set_button_binary_sensor(binary_sensor::BinarySensor *button_binary_sensor);
+#endif
+            void set_irq_pin(InternalGPIOPin *irq_pin) { irq_pin_ = irq_pin; }
+            // IRQ enable registers 0x40..0x43, 0x40 in the most significant byte
+            void set_irq_enable_mask(uint32_t irq_enable_mask) { irq_enable_mask_ |= irq_enable_mask; }
+            void add_on_event_callback(AXP192Event event, std::function<void()> &&callback);
+            // Applied straight away once the PMIC is set up, before that by setup()
             void set_brightness(float brightness)
             {
                 brightness_ = brightness;
-                UpdateBrightness();
+                if (backlight_ready_)
+                    UpdateBrightness();
             }
 
             void setup() override;
             void dump_config() override;
+            void on_shutdown() override;
             float get_setup_priority() const override;
+            bool can_proceed() override { return rails_settled_; }
             void update() override;
+            void loop() override;
 
             // -- sleep
             void SetSleep(void);
-            void DeepSleep(uint64_t time_in_us = 0);
-            void LightSleep(uint64_t time_in_us = 0);
+            void SetSleep(const AXP192SleepProfile *profile);
+            void DeepSleep(uint64_t time_in_us = 0, const AXP192SleepProfile *profile = nullptr);
+            void LightSleep(uint64_t time_in_us = 0, const AXP192SleepProfile *profile = nullptr);
+
+            void add_sleep_profile(const char *name, uint8_t rails, uint16_t adc_channels, uint64_t wake_pins,
+                                   bool wake_any_high, bool wake_on_irq, int8_t charge_current, int64_t irq_mask = -1)
+            {
+                this->sleep_profiles_.push_back(
+                    {name, rails, adc_channels, wake_pins, wake_any_high, wake_on_irq, charge_current, irq_mask});
+            }
+            // nullptr selects the model default profile
+            const AXP192SleepProfile *find_sleep_profile(const char *name) const;
 
             // void SetChargeVoltage( uint8_t );
             void SetChargeCurrent(uint8_t);
@@ -82,26 +558,173 @@ namespace esphome
             void SetCoulombClear();
             void SetLDO2(bool State);
             void SetLDO3(bool State);
+
+            // Every rail goes through the cached registers: a toggle is at most one write, a no-op none
+            void SetRailEnabled(AXP192Rail rail, bool enabled);
+            bool GetRailEnabled(AXP192Rail rail);
+            // Rounded down to the rail's step and clamped to its range
+            void SetRailVoltage(AXP192Rail rail, uint16_t millivolts);
+            uint16_t GetRailVoltage(AXP192Rail rail);
+            static const AXP192RailDescriptor &GetRailDescriptor(AXP192Rail rail);
+            // Off keeps the channels the PMIC itself relies on, see AdcIdleChannels()
             void SetAdcState(bool State);
 
             void PowerOff();
 
+            // Re-read the cached control registers, for when something else has written to the PMIC
+            void ResyncRegisters();
+
+            const AXP192I2CStats &get_i2c_stats() const { return i2c_stats_; }
+            void LogI2CStats();
+
+            // Request ADC channels (AXP192AdcChannel bits) and a minimum sample rate; channels stay enabled once requested
+            void RegisterAdcChannels(uint16_t channels, AXP192AdcRate min_rate = ADC_RATE_25HZ);
+
         private:
-            static std::string GetStartupReason();
+            static const char *GetStartupReason();
 
         protected:
-            sensor::Sensor *batterylevel_sensor_;
-            sensor::Sensor *batteryvoltage_sensor_;
-            sensor::Sensor *batterycurrent_sensor_;
-            sensor::Sensor *vbusvoltage_sensor_;
-            sensor::Sensor *vbuscurrent_sensor_;
-            sensor::Sensor *vincurrent_sensor_;
-            sensor::Sensor *temperature_sensor_;
+            sensor::Sensor *batterylevel_sensor_{nullptr};
+            sensor::Sensor *channel_sensors_[CHANNEL_COUNT]{};
+            sensor::Sensor *channel_min_sensors_[CHANNEL_COUNT]{};
+            sensor::Sensor *channel_max_sensors_[CHANNEL_COUNT]{};
+            AXP192Aggregate channel_stats_[CHANNEL_COUNT];
+            uint32_t fast_sample_interval_{0};
+            uint32_t channel_interval_[CHANNEL_COUNT]{};
+
+            // Resumable acquisition state and loop() timing
+            AXP192UpdateState update_state_{UPDATE_IDLE};
+            uint8_t update_due_{0};
+            uint8_t update_channel_{0};
+            uint32_t loop_budget_{2000};
+            uint32_t loop_time_max_{0};
+            sensor::Sensor *loop_time_sensor_{nullptr};
+
+            // Bus health accounting
+            AXP192I2CStats i2c_stats_;
+            uint32_t i2c_failures_reported_{0};
+            sensor::Sensor *i2c_transactions_sensor_{nullptr};
+            sensor::Sensor *i2c_failures_sensor_{nullptr};
+            sensor::Sensor *i2c_retries_sensor_{nullptr};
+            sensor::Sensor *i2c_latency_sensor_{nullptr};
+            uint32_t channel_next_[CHANNEL_COUNT]{};
+#ifdef USE_BINARY_SENSOR
+            binary_sensor::BinarySensor *vbus_binary_sensor_{nullptr};
+            binary_sensor::BinarySensor *charging_binary_sensor_{nullptr};
+            binary_sensor::BinarySensor *lowbattery_binary_sensor_{nullptr};
+            binary_sensor::BinarySensor *button_binary_sensor_{nullptr};
+#endif
             float brightness_{1.0f};
             float curr_brightness_{-1.0f};
-            AXP192Model model_;
+            bool backlight_ready_{false};
+            // Held back by can_proceed() until the rails begin() raised have settled
+            bool rails_settled_{false};
             AXP192ChargeCurrent charge_current_;
 
+            // Enabled ADC channels and sample rate, written to the PMIC once begin() has run
+            uint16_t adc_channels_{0};
+            AXP192AdcRate adc_rate_{ADC_RATE_25HZ};
+            bool adc_configured_{false};
+            // Duty cycling: 0x82/0x83 hold adc_channels_ only while powered, AdcIdleChannels() otherwise
+            bool adc_duty_cycle_{false};
+            bool adc_powered_{true};
+            uint32_t adc_settle_time_{0};
+            uint32_t adc_wake_time_{0};
+
+            // IRQ line, set from the ISR and serviced from loop()
+            InternalGPIOPin *irq_pin_{nullptr};
+            volatile bool irq_pending_{false};
+            volatile uint32_t irq_edge_us_{0};
+            uint32_t irq_enable_mask_{0};
+            CallbackManager<void(AXP192Event)> event_callback_;
+
+            // Coulomb counter fuel gauge: charge_mah_ is the battery charge at counter value ref_counts_
+            float battery_capacity_{0.0f};
+            float fuel_charge_mah_{0.0f};
+            int64_t fuel_ref_counts_{0};
+            uint32_t fuel_rest_since_{0};
+            bool fuel_gauge_ready_{false};
+            // Charge the counter has seen since boot, without the clamping and OCV correction of fuel_charge_mah_
+            float fuel_coulomb_mah_{0.0f};
+
+            // Runtime estimate: exponentially weighted battery current in mA, positive while charging
+            sensor::Sensor *time_to_empty_sensor_{nullptr};
+            sensor::Sensor *time_to_full_sensor_{nullptr};
+            float runtime_current_ma_{0.0f};
+            float runtime_last_mah_{0.0f};
+            uint32_t runtime_last_time_{0};
+            bool runtime_charging_{false};
+            bool runtime_primed_{false};
+            bool runtime_reseed_{false};
+
+            // Energy accounting: totals in nanojoules, trapezoid integration between updates
+            sensor::Sensor *energy_sensors_[ENERGY_COUNT]{};
+            AXP192EnergyRecord energy_{};
+            int64_t energy_last_power_[ENERGY_COUNT]{};
+            uint32_t energy_last_time_{0};
+            bool energy_primed_{false};
+            uint32_t energy_commit_interval_{3600000};
+            uint32_t energy_uncommitted_ms_{0};
+            ESPPreferenceObject energy_prefs_[AXP192_ENERGY_SLOTS];
+
+            // Charge controller, limits in integer milli-units like the ADC kernel
+            bool charge_controller_{false};
+            AXP192ChargeCurrent charge_ceiling_{CURRENT_100MA};
+            int32_t charge_vbus_limit_ma_{500};
+            int32_t charge_vbus_min_mv_{4500};
+            int32_t charge_max_temp_mc_{70000};
+            uint8_t charge_step_{0};
+            uint32_t charge_last_raise_{0};
+
+            // Low battery emergency shutdown, thresholds in mV
+            bool shutdown_enabled_{false};
+            int32_t shutdown_warning_mv_{3450};
+            int32_t shutdown_mv_{3300};
+            uint32_t shutdown_poll_interval_{1000};
+            uint32_t shutdown_deadline_{2000};
+            bool shutdown_deep_sleep_{false};
+            const char *shutdown_profile_{nullptr};
+            bool shutdown_automation_{false};
+            bool shutdown_started_{false};
+            uint32_t shutdown_warning_us_{0};
+            CallbackManager<void()> shutdown_callback_;
+            void EmergencyShutdown(uint32_t warning_us);
+            void FinishShutdown();
+            void ReportLastShutdown();
+
+            // History log
+            uint32_t history_interval_{0};
+            uint32_t history_last_{0};
+            bool history_logged_{false};
+            int16_t history_dump_next_{-1};
+            void LogHistorySample();
+            void DumpHistoryBlock();
+
+#ifdef AXP192_TRACE_RECORDS
+            // Trace ring: trace_total_ records written so far, the oldest overwritten once it is full
+            AXP192TraceRecord trace_[AXP192_TRACE_RECORDS];
+            uint16_t trace_head_{0};
+            uint32_t trace_total_{0};
+            int32_t trace_dump_next_{-1};
+            void Trace(AXP192TraceKind kind, uint8_t reg, uint16_t value);
+            void DumpTraceChunk();
+#endif
+
+            // Snapshot of the ADC result block, valid between ReadAdcBlock() and ReleaseAdcBlock()
+            uint8_t adc_block_[AXP192_ADC_BLOCK_SIZE];
+            // Register range [adc_block_first_, adc_block_last_] currently held, empty when first > last
+            uint8_t adc_block_first_{1};
+            uint8_t adc_block_last_{0};
+
+            // Write-through shadow of the control registers, filled lazily on first access
+            uint8_t reg_cache_[AXP192_CACHED_REGISTER_COUNT];
+            uint32_t reg_cache_valid_{0};
+
+            // Pending register/value pairs while a write batch is open
+            uint8_t write_batch_[AXP192_WRITE_BATCH_MAX * 2];
+            uint8_t write_batch_len_{0};
+            bool write_batch_active_{false};
+
             // M5 Stick Values
             // LDO2: Display backlight
             // LDO3: Display Control
@@ -120,8 +743,39 @@ namespace esphome
             // DCDC1: NC
             // DCDC3: VDD3V3
 
-            void begin(bool disableLDO2 = false, bool disableLDO3 = false, bool disableRTC = false, bool disableDCDC1 = false, bool disableDCDC3 = false);
+            void begin();
+            uint16_t ConfiguredAdcChannels();
+
+            // Deep sleep fast wake: DeepSleep() leaves the register state in RTC memory, setup() restores just the sleep delta
+            uint32_t ConfigSignature();
+            void SaveSleepState();
+            void SaveSleptState();
+            bool RestoreFromSleep();
+            bool fast_wake_{false};
+            // The IRQ enables a profile's irq_mask replaces, 0x40..0x43 then 0x4A
+            bool ReadIrqEnables(uint8_t *enables);
+            void WriteIrqEnables(const uint8_t *enables);
+
+            std::vector<AXP192SleepProfile> sleep_profiles_;
+            void ArmWakeSources(const AXP192SleepProfile *profile);
+            bool first_update_logged_{false};
             void UpdateBrightness();
+            bool ChannelUsed(uint8_t channel);
+            float ReadChannel(uint8_t channel);
+            // Decode one quantity, from the held ADC span when it covers it and from the bus otherwise
+            bool DecodeQuantity(AXP192Quantity quantity, int32_t *milli);
+            float ReadQuantity(AXP192Quantity quantity, float scale);
+            void SampleChannels();
+            // Read every channel in the mask with a single contiguous transfer
+            bool ReadChannelSpan(uint8_t mask);
+            void PublishChannels(uint8_t mask);
+            void PublishBatteryLevel();
+            void PublishDiagnostics();
+            // Run one acquisition step, returns false once the acquisition is complete
+            bool StepUpdate();
+            void WriteAdcConfig();
+            uint16_t AdcIdleChannels();
+            uint32_t AdcSettleTime();
             bool GetBatState();
             uint8_t GetBatData();
 
@@ -133,17 +787,63 @@ namespace esphome
             uint32_t GetCoulombChargeData(void);
             uint32_t GetCoulombDischargeData(void);
             float GetCoulombData(void);
+            float CoulombMahPerCount();
+            bool ReadCoulombCounts(int64_t *net);
+
+            // State of charge from the coulomb counter, corrected against the OCV curve at rest
+            void SetupFuelGauge();
+            float UpdateFuelGauge(float vbat, float ibat);
+            void RebaseFuelGauge();
+            static float OcvToSoc(float vbat);
+
+            bool RuntimeUsed();
+            void UpdateRuntime();
+
+            // Channels read for the controller and history even without a sensor
+            uint8_t InternalChannels();
+            void ControlChargeCurrent();
+
+            bool EnergyUsed();
+            void SetupEnergy();
+            void UpdateEnergy();
+            void CommitEnergy();
 
             uint8_t GetBtnPress(void);
 
+            // Read, acknowledge and dispatch pending IRQ status bits; edge_us is when the IRQ line fell, 0 when polled
+            void ServiceIrq(uint32_t edge_us = 0);
+            void HandleEvent(AXP192Event event);
+            static void gpio_intr(AXP192Component *arg);
+
+            // Bulk ADC acquisition: while the snapshot is held, ADC getters decode from it instead of the bus
+            bool ReadAdcBlock();
+            bool ReadAdcRange(uint8_t first, uint8_t last);
+            void ReleaseAdcBlock()
+            {
+                adc_block_first_ = 1;
+                adc_block_last_ = 0;
+            }
+
+            int8_t CacheIndex(uint8_t Addr);
+            void UpdateBits(uint8_t Addr, uint8_t Mask, uint8_t Value);
+
+            // Queue Write1Byte calls and send them as address/data pairs in one transaction
+            void BeginWriteBatch();
+            void FlushWriteBatch();
+
             void Write1Byte(uint8_t Addr, uint8_t Data);
             uint8_t Read8bit(uint8_t Addr);
-            uint16_t Read12Bit(uint8_t Addr);
-            uint16_t Read13Bit(uint8_t Addr);
-            uint16_t Read16bit(uint8_t Addr);
-            uint32_t Read24bit(uint8_t Addr);
-            uint32_t Read32bit(uint8_t Addr);
-            void ReadBuff(uint8_t Addr, uint8_t Size, uint8_t *Buff);
+            bool ReadByte(uint8_t Addr, uint8_t *Data);
+            bool Read16bit(uint8_t Addr, uint16_t *Data);
+            bool Read24bit(uint8_t Addr, uint32_t *Data);
+            bool Read32bit(uint8_t Addr, uint32_t *Data);
+            bool ReadBuff(uint8_t Addr, uint8_t Size, uint8_t *Buff);
+
+            // All bus traffic goes through these, with retry and accounting
+            template <typename F>
+            bool RunTransaction(F &&transfer);
+            bool ReadBytes(uint8_t Addr, uint8_t *Buff, uint8_t Size);
+            bool WriteBytes(const uint8_t *Data, uint8_t Size);
         };
     }
 }
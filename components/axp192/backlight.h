@@ -0,0 +1,25 @@
+#ifndef __AXP192_BACKLIGHT_H__
+#define __AXP192_BACKLIGHT_H__
+
+#include "axp192.h"
+
+#ifdef USE_OUTPUT
+#include "esphome/components/output/float_output.h"
+
+namespace esphome
+{
+    namespace axp192
+    {
+
+        // The model backlight rail as a float output; every write goes to the PMIC immediately
+        class AXP192Backlight : public output::FloatOutput, public Parented<AXP192Component>
+        {
+        protected:
+            void write_state(float state) override { this->parent_->set_brightness(state); }
+        };
+
+    }
+}
+
+#endif
+#endif
@@ -0,0 +1,23 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import binary_sensor
+from esphome.const import CONF_TYPE
+from . import AXP192Component, CONF_AXP192_ID
+
+TYPES = {
+    "vbus": "set_vbus_binary_sensor",
+    "charging": "set_charging_binary_sensor",
+    "low_battery": "set_lowbattery_binary_sensor",
+    "button": "set_button_binary_sensor",
+}
+
+CONFIG_SCHEMA = binary_sensor.binary_sensor_schema().extend({
+    cv.GenerateID(CONF_AXP192_ID): cv.use_id(AXP192Component),
+    cv.Required(CONF_TYPE): cv.one_of(*TYPES, lower=True),
+})
+
+
+def to_code(config):
+    hub = yield cg.get_variable(config[CONF_AXP192_ID])
+    var = yield binary_sensor.new_binary_sensor(config)
+    cg.add(getattr(hub, TYPES[config[CONF_TYPE]])(var))
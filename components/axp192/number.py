@@ -0,0 +1,24 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import number
+from esphome.const import CONF_ID, CONF_UNIT_OF_MEASUREMENT, UNIT_VOLT
+from . import axp192_ns, AXP192Component, CONF_AXP192_ID, CONF_RAIL, RAILS, validate_rail
+
+AXP192RailNumber = axp192_ns.class_("AXP192RailNumber", number.Number, cg.Component)
+
+# Voltage setpoint of a rail, range and step come from the rail
+CONFIG_SCHEMA = number.NUMBER_SCHEMA.extend({
+    cv.GenerateID(): cv.declare_id(AXP192RailNumber),
+    cv.GenerateID(CONF_AXP192_ID): cv.use_id(AXP192Component),
+    cv.Required(CONF_RAIL): validate_rail,
+    cv.Optional(CONF_UNIT_OF_MEASUREMENT, default=UNIT_VOLT): cv.string_strict,
+}).extend(cv.COMPONENT_SCHEMA)
+
+
+def to_code(config):
+    rail, min_voltage, max_voltage, step = RAILS[config[CONF_RAIL]]
+    var = cg.new_Pvariable(config[CONF_ID])
+    yield cg.register_component(var, config)
+    yield number.register_number(var, config, min_value=min_voltage, max_value=max_voltage, step=step)
+    yield cg.register_parented(var, config[CONF_AXP192_ID])
+    cg.add(var.set_rail(rail))
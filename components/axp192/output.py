@@ -0,0 +1,44 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import output
+from esphome.const import CONF_ID, CONF_MIN_VOLTAGE, CONF_MAX_VOLTAGE
+from . import axp192_ns, AXP192Component, CONF_AXP192_ID, CONF_RAIL, RAILS, validate_rail
+
+AXP192Backlight = axp192_ns.class_("AXP192Backlight", output.FloatOutput)
+AXP192RailOutput = axp192_ns.class_("AXP192RailOutput", output.FloatOutput)
+
+
+def validate_voltage_range(config):
+    _, min_voltage, max_voltage, _ = RAILS[config[CONF_RAIL]]
+    config.setdefault(CONF_MIN_VOLTAGE, min_voltage)
+    config.setdefault(CONF_MAX_VOLTAGE, max_voltage)
+    if not min_voltage <= config[CONF_MIN_VOLTAGE] <= config[CONF_MAX_VOLTAGE] <= max_voltage:
+        raise cv.Invalid(f"{config[CONF_RAIL]} supports {min_voltage}V to {max_voltage}V")
+    return config
+
+
+# A rail driven as a level: 0 is off, the rest spans min_voltage..max_voltage
+RAIL_SCHEMA = cv.All(output.FLOAT_OUTPUT_SCHEMA.extend({
+    cv.Required(CONF_ID): cv.declare_id(AXP192RailOutput),
+    cv.GenerateID(CONF_AXP192_ID): cv.use_id(AXP192Component),
+    cv.Required(CONF_RAIL): validate_rail,
+    cv.Optional(CONF_MIN_VOLTAGE): cv.voltage,
+    cv.Optional(CONF_MAX_VOLTAGE): cv.voltage,
+}), validate_voltage_range)
+
+# The brightness curve is applied in the component, pair this with gamma_correct: 1.0 on the light
+BACKLIGHT_SCHEMA = output.FLOAT_OUTPUT_SCHEMA.extend({
+    cv.Required(CONF_ID): cv.declare_id(AXP192Backlight),
+    cv.GenerateID(CONF_AXP192_ID): cv.use_id(AXP192Component),
+})
+
+CONFIG_SCHEMA = cv.Any(RAIL_SCHEMA, BACKLIGHT_SCHEMA)
+
+
+def to_code(config):
+    var = cg.new_Pvariable(config[CONF_ID])
+    yield output.register_output(var, config)
+    yield cg.register_parented(var, config[CONF_AXP192_ID])
+    if CONF_RAIL in config:
+        cg.add(var.set_rail(RAILS[config[CONF_RAIL]][0]))
+        cg.add(var.set_voltage_range(config[CONF_MIN_VOLTAGE], config[CONF_MAX_VOLTAGE]))
@@ -0,0 +1,95 @@
+#ifndef __AXP192_RAILS_H__
+#define __AXP192_RAILS_H__
+
+#include "esphome/core/component.h"
+#include "axp192.h"
+
+#ifdef USE_SWITCH
+#include "esphome/components/switch/switch.h"
+#endif
+#ifdef USE_NUMBER
+#include "esphome/components/number/number.h"
+#endif
+#ifdef USE_OUTPUT
+#include "esphome/components/output/float_output.h"
+#endif
+
+namespace esphome
+{
+    namespace axp192
+    {
+
+        // Entities for one power rail; setup() runs after the PMIC and reports what it actually holds
+#ifdef USE_SWITCH
+        class AXP192RailSwitch : public switch_::Switch, public Component, public Parented<AXP192Component>
+        {
+        public:
+            void set_rail(AXP192Rail rail) { rail_ = rail; }
+            void setup() override { this->publish_state(this->parent_->GetRailEnabled(rail_)); }
+            float get_setup_priority() const override { return setup_priority::DATA - 1.0f; }
+
+        protected:
+            void write_state(bool state) override
+            {
+                this->parent_->SetRailEnabled(rail_, state);
+                this->publish_state(state);
+            }
+
+            AXP192Rail rail_;
+        };
+#endif
+
+#ifdef USE_NUMBER
+        // Voltage setpoint in V
+        class AXP192RailNumber : public number::Number, public Component, public Parented<AXP192Component>
+        {
+        public:
+            void set_rail(AXP192Rail rail) { rail_ = rail; }
+            void setup() override { this->publish_state(this->parent_->GetRailVoltage(rail_) / 1000.0f); }
+            float get_setup_priority() const override { return setup_priority::DATA - 1.0f; }
+
+        protected:
+            void control(float value) override
+            {
+                this->parent_->SetRailVoltage(rail_, static_cast<uint16_t>(value * 1000.0f + 0.5f));
+                this->publish_state(this->parent_->GetRailVoltage(rail_) / 1000.0f);
+            }
+
+            AXP192Rail rail_;
+        };
+#endif
+
+#ifdef USE_OUTPUT
+        // 0 switches the rail off, anything else maps linearly onto [min_voltage, max_voltage]
+        class AXP192RailOutput : public output::FloatOutput, public Parented<AXP192Component>
+        {
+        public:
+            void set_rail(AXP192Rail rail) { rail_ = rail; }
+            void set_voltage_range(float min_voltage, float max_voltage)
+            {
+                min_mv_ = min_voltage * 1000.0f;
+                max_mv_ = max_voltage * 1000.0f;
+            }
+
+        protected:
+            void write_state(float state) override
+            {
+                if (state <= 0.0f)
+                {
+                    this->parent_->SetRailEnabled(rail_, false);
+                    return;
+                }
+                this->parent_->SetRailVoltage(rail_, min_mv_ + static_cast<uint16_t>(state * (max_mv_ - min_mv_) + 0.5f));
+                this->parent_->SetRailEnabled(rail_, true);
+            }
+
+            AXP192Rail rail_;
+            uint16_t min_mv_{0};
+            uint16_t max_mv_{0};
+        };
+#endif
+
+    }
+}
+
+#endif
@@ -1,18 +1,65 @@
+import hashlib
+import json
+from pathlib import Path
+
 import esphome.codegen as cg
 import esphome.config_validation as cv
+from esphome import automation, pins
 from esphome.components import i2c, sensor
-from esphome.const import CONF_ID,\
+from esphome.const import CONF_ID, CONF_NAME, CONF_TRIGGER_ID, CONF_UPDATE_INTERVAL,\
     CONF_BATTERY_LEVEL, CONF_BATTERY_VOLTAGE, CONF_VOLTAGE, CONF_CURRENT, CONF_BRIGHTNESS,\
-    CONF_TEMPERATURE, UNIT_PERCENT, UNIT_VOLT, UNIT_AMPERE, UNIT_CELSIUS, ICON_BATTERY, ICON_CURRENT_AC, ICON_THERMOMETER, CONF_MODEL, CONF_MAX_CURRENT
+    CONF_TEMPERATURE, CONF_INTERVAL, STATE_CLASS_TOTAL_INCREASING, DEVICE_CLASS_ENERGY, UNIT_WATT_HOURS, ICON_FLASH, UNIT_MILLISECOND, ENTITY_CATEGORY_DIAGNOSTIC, ICON_TIMER, UNIT_MINUTE, DEVICE_CLASS_DURATION, UNIT_PERCENT, UNIT_VOLT, UNIT_AMPERE, UNIT_CELSIUS, ICON_BATTERY, ICON_CURRENT_AC, ICON_THERMOMETER, CONF_MODEL, CONF_MAX_CURRENT
+
+from . import axp192_ns, AXP192Component, AXP192Event, CONF_PROFILE
 
 DEPENDENCIES = ['i2c']
 CONF_BATTERY_CURRENT = "battery_current"
 CONF_VIN_CURRENT = "vin_current"
+CONF_IRQ_PIN = "irq_pin"
+CONF_IRQ_ENABLE_MASK = "irq_enable_mask"
+CONF_BATTERY_CAPACITY = "battery_capacity"
+CONF_TIME_TO_EMPTY = "time_to_empty"
+CONF_TIME_TO_FULL = "time_to_full"
+CONF_FAST_SAMPLE_INTERVAL = "fast_sample_interval"
+CONF_LOOP_BUDGET = "loop_budget"
+CONF_ADC_DUTY_CYCLE = "adc_duty_cycle"
+CONF_ADC_SETTLE_TIME = "adc_settle_time"
+CONF_MAX_LOOP_TIME = "max_loop_time"
+CONF_I2C_TRANSACTIONS = "i2c_transactions"
+CONF_I2C_FAILURES = "i2c_failures"
+CONF_I2C_RETRIES = "i2c_retries"
+CONF_I2C_MAX_LATENCY = "i2c_max_latency"
+CONF_ENERGY_COMMIT_INTERVAL = "energy_commit_interval"
+CONF_CHARGE_CONTROLLER = "charge_controller"
+CONF_VBUS_CURRENT_LIMIT = "vbus_current_limit"
+CONF_VBUS_MIN_VOLTAGE = "vbus_min_voltage"
+CONF_MAX_TEMPERATURE = "max_temperature"
+CONF_HISTORY = "history"
+CONF_BLOCKS = "blocks"
+CONF_SLEEP_PROFILES = "sleep_profiles"
+CONF_RAILS = "rails"
+CONF_ADC_CHANNELS = "adc_channels"
+CONF_WAKE_PINS = "wake_pins"
+CONF_WAKE_PIN_MODE = "wake_pin_mode"
+CONF_WAKE_ON_IRQ = "wake_on_irq"
+CONF_MIN = "min"
+CONF_LOW_BATTERY_SHUTDOWN = "low_battery_shutdown"
+CONF_WARNING_VOLTAGE = "warning_voltage"
+CONF_SHUTDOWN_VOLTAGE = "shutdown_voltage"
+CONF_POLL_INTERVAL = "poll_interval"
+CONF_DEADLINE = "deadline"
+CONF_ACTION = "action"
+CONF_ON_SHUTDOWN = "on_shutdown"
+CONF_TRACE = "trace"
+CONF_RECORDS = "records"
+CONF_MAX = "max"
 
-axp192_ns = cg.esphome_ns.namespace('axp192')
-AXP192Component = axp192_ns.class_('AXP192Component', cg.PollingComponent, i2c.I2CDevice)
+AXP192EventTrigger = axp192_ns.class_('AXP192EventTrigger', automation.Trigger.template())
+AXP192LowBatteryShutdownTrigger = axp192_ns.class_('AXP192LowBatteryShutdownTrigger', automation.Trigger.template())
 AXP192Model = axp192_ns.enum("AXP192Model")
 AXP192ChargeCurrent = axp192_ns.enum("AXP192ChargeCurrent")
+AXP192Channel = axp192_ns.enum("AXP192Channel")
+AXP192EnergyCounter = axp192_ns.enum("AXP192EnergyCounter")
 
 MODELS = {
     "M5CORE2": AXP192Model.AXP192_M5CORE2,
@@ -32,9 +79,201 @@ CHARGE_CURRENTS = {
     "700MA": AXP192ChargeCurrent.CURRENT_700MA,
 }
 
+EVENT_TRIGGERS = {
+    "on_button_short_press": AXP192Event.EVENT_BUTTON_SHORT_PRESS,
+    "on_button_long_press": AXP192Event.EVENT_BUTTON_LONG_PRESS,
+    "on_vbus_insert": AXP192Event.EVENT_VBUS_INSERT,
+    "on_vbus_remove": AXP192Event.EVENT_VBUS_REMOVE,
+    "on_low_battery": AXP192Event.EVENT_LOW_BATTERY,
+    "on_charge_start": AXP192Event.EVENT_CHARGE_START,
+    "on_charge_done": AXP192Event.EVENT_CHARGE_DONE,
+}
+
+CHANNELS = {
+    CONF_BATTERY_VOLTAGE: AXP192Channel.CHANNEL_BAT_VOLTAGE,
+    CONF_BATTERY_CURRENT: AXP192Channel.CHANNEL_BAT_CURRENT,
+    CONF_VOLTAGE: AXP192Channel.CHANNEL_VBUS_VOLTAGE,
+    CONF_CURRENT: AXP192Channel.CHANNEL_VBUS_CURRENT,
+    CONF_VIN_CURRENT: AXP192Channel.CHANNEL_VIN_CURRENT,
+    CONF_TEMPERATURE: AXP192Channel.CHANNEL_TEMPERATURE,
+}
+
+
+def channel_schema(unit, icon):
+    # Optional min/max companions report the extremes seen by fast sampling
+    return sensor.sensor_schema(
+        unit_of_measurement=unit,
+        accuracy_decimals=1,
+        icon=icon,
+    ).extend({
+        # Publish this channel on its own schedule instead of the component update_interval
+        cv.Optional(CONF_UPDATE_INTERVAL): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_MIN): sensor.sensor_schema(
+            unit_of_measurement=unit,
+            accuracy_decimals=1,
+            icon=icon,
+        ),
+        cv.Optional(CONF_MAX): sensor.sensor_schema(
+            unit_of_measurement=unit,
+            accuracy_decimals=1,
+            icon=icon,
+        ),
+    })
+
+
+ENERGY_COUNTERS = {
+    "battery_charge_energy": AXP192EnergyCounter.ENERGY_BAT_CHARGE,
+    "battery_discharge_energy": AXP192EnergyCounter.ENERGY_BAT_DISCHARGE,
+    "vbus_energy": AXP192EnergyCounter.ENERGY_VBUS,
+    "vin_energy": AXP192EnergyCounter.ENERGY_VIN,
+}
+
+# Bits of the output control register 0x12, DCDC1 powers the ESP and always stays on
+SLEEP_RAILS = {
+    "DCDC2": 1 << 4,
+    "DCDC3": 1 << 1,
+    "LDO2": 1 << 2,
+    "LDO3": 1 << 3,
+    "EXTEN": 1 << 6,
+}
+# Same bits as AXP192AdcChannel
+SLEEP_ADC_CHANNELS = {
+    "battery_voltage": 0x8000,
+    "battery_current": 0x4000,
+    "acin_voltage": 0x2000,
+    "acin_current": 0x1000,
+    "vbus_voltage": 0x0800,
+    "vbus_current": 0x0400,
+    "aps_voltage": 0x0200,
+    "ts_pin": 0x0100,
+    "temperature": 0x0080,
+}
+# Only RTC GPIOs can wake the ESP32 from deep sleep
+RTC_GPIOS = [0, 2, 4, 12, 13, 14, 15, 25, 26, 27, 32, 33, 34, 35, 36, 37, 38, 39]
+
+I2C_COUNTERS = {
+    CONF_I2C_TRANSACTIONS: "set_i2c_transactions_sensor",
+    CONF_I2C_FAILURES: "set_i2c_failures_sensor",
+    CONF_I2C_RETRIES: "set_i2c_retries_sensor",
+}
+
+RUNTIME_SENSORS = {
+    CONF_TIME_TO_EMPTY: "set_time_to_empty_sensor",
+    CONF_TIME_TO_FULL: "set_time_to_full_sensor",
+}
+
 AXP192_MODEL = cv.enum(MODELS, upper=True, space="_")
 AXP192_CHARGE_CURRENT = cv.enum(CHARGE_CURRENTS, upper=True, space="")
 
+SLEEP_PROFILE_SCHEMA = cv.Schema({
+    cv.Required(CONF_NAME): cv.string_strict,
+    cv.Optional(CONF_RAILS, default=[]): cv.ensure_list(cv.one_of(*SLEEP_RAILS, upper=True)),
+    cv.Optional(CONF_ADC_CHANNELS, default=[]): cv.ensure_list(cv.one_of(*SLEEP_ADC_CHANNELS, lower=True)),
+    cv.Optional(CONF_WAKE_PINS, default=[]): cv.ensure_list(cv.one_of(*RTC_GPIOS, int=True)),
+    cv.Optional(CONF_WAKE_PIN_MODE, default="ALL_LOW"): cv.one_of("ALL_LOW", "ANY_HIGH", upper=True),
+    cv.Optional(CONF_WAKE_ON_IRQ, default=False): cv.boolean,
+    # Charge current while asleep, unchanged when omitted
+    cv.Optional(CONF_MAX_CURRENT): AXP192_CHARGE_CURRENT,
+    # IRQ enables while asleep: 0x40..0x43 then 0x4A, most significant byte first; unchanged when omitted
+    cv.Optional(CONF_IRQ_ENABLE_MASK): cv.All(cv.hex_int, cv.Range(min=0, max=0xFFFFFFFFFF)),
+})
+
+
+# Raises the charge current towards max_current while VBUS stays within the USB budget
+CHARGE_CONTROLLER_SCHEMA = cv.Schema({
+    cv.Required(CONF_MAX_CURRENT): AXP192_CHARGE_CURRENT,
+    cv.Optional(CONF_VBUS_CURRENT_LIMIT, default="500mA"): cv.All(cv.current, cv.Range(min=0.1, max=3.0)),
+    cv.Optional(CONF_VBUS_MIN_VOLTAGE, default="4.5V"): cv.All(cv.voltage, cv.Range(min=4.1, max=5.0)),
+    cv.Optional(CONF_MAX_TEMPERATURE, default="70°C"): cv.temperature,
+})
+
+
+# 64 byte blocks of 17 samples in RTC slow memory; the defaults hold 48h at 5min. 48 blocks keep the component's
+# RTC state within the 4 kB axp192.cpp asserts, half of the ESP32's RTC slow memory
+HISTORY_SCHEMA = cv.Schema({
+    cv.Optional(CONF_INTERVAL, default="5min"): cv.All(
+        cv.positive_time_period_milliseconds,
+        cv.Range(min=cv.TimePeriod(seconds=10), max=cv.TimePeriod(hours=18)),
+    ),
+    cv.Optional(CONF_BLOCKS, default=36): cv.int_range(min=2, max=48),
+})
+
+# 0x3A/0x3B step 5.6mV from 2.8672V
+APS_WARNING_VOLTAGE = cv.All(cv.voltage, cv.Range(min=2.87, max=4.29))
+
+LOW_BATTERY_SHUTDOWN_SCHEMA = cv.Schema({
+    cv.Optional(CONF_WARNING_VOLTAGE, default="3.45V"): APS_WARNING_VOLTAGE,
+    cv.Optional(CONF_SHUTDOWN_VOLTAGE, default="3.3V"): APS_WARNING_VOLTAGE,
+    # Only used without irq_pin
+    cv.Optional(CONF_POLL_INTERVAL, default="1s"): cv.All(
+        cv.positive_time_period_milliseconds,
+        cv.Range(min=cv.TimePeriod(milliseconds=100), max=cv.TimePeriod(seconds=10)),
+    ),
+    # Time on_shutdown gets before the power goes, whether it has finished or not
+    cv.Optional(CONF_DEADLINE, default="2s"): cv.All(
+        cv.positive_time_period_milliseconds,
+        cv.Range(max=cv.TimePeriod(seconds=30)),
+    ),
+    cv.Optional(CONF_ACTION, default="POWER_OFF"): cv.one_of("POWER_OFF", "DEEP_SLEEP", upper=True),
+    # Sleep profile for DEEP_SLEEP, the model default when omitted
+    cv.Optional(CONF_PROFILE): cv.string_strict,
+    cv.Optional(CONF_ON_SHUTDOWN): automation.validate_automation({
+        cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(AXP192LowBatteryShutdownTrigger),
+    }),
+})
+
+# 8 byte records in RAM, only compiled in when present
+TRACE_SCHEMA = cv.Schema({
+    cv.Optional(CONF_RECORDS, default=256): cv.int_range(min=16, max=4096),
+})
+
+
+def validate_low_battery_shutdown(config):
+    if CONF_LOW_BATTERY_SHUTDOWN not in config:
+        return config
+    conf = config[CONF_LOW_BATTERY_SHUTDOWN]
+    if conf[CONF_SHUTDOWN_VOLTAGE] >= conf[CONF_WARNING_VOLTAGE]:
+        raise cv.Invalid("low_battery_shutdown shutdown_voltage must be below warning_voltage")
+    if CONF_PROFILE in conf:
+        if conf[CONF_ACTION] != "DEEP_SLEEP":
+            raise cv.Invalid("low_battery_shutdown profile requires action DEEP_SLEEP")
+        if conf[CONF_PROFILE] not in [profile[CONF_NAME] for profile in config.get(CONF_SLEEP_PROFILES, [])]:
+            raise cv.Invalid(f"Unknown sleep profile {conf[CONF_PROFILE]}")
+    return config
+
+
+def validate_sleep_profiles(config):
+    names = [profile[CONF_NAME] for profile in config.get(CONF_SLEEP_PROFILES, [])]
+    if len(names) != len(set(names)):
+        raise cv.Invalid("Sleep profile names must be unique")
+    for profile in config.get(CONF_SLEEP_PROFILES, []):
+        if profile[CONF_WAKE_ON_IRQ] and CONF_IRQ_PIN not in config:
+            raise cv.Invalid(f"Sleep profile {profile[CONF_NAME]} wakes on IRQ but no irq_pin is set")
+    return config
+
+
+def validate_runtime(config):
+    # The estimate needs the remaining charge, which only the coulomb counter fuel gauge provides
+    for key in RUNTIME_SENSORS:
+        if key in config and CONF_BATTERY_CAPACITY not in config:
+            raise cv.Invalid(f"{key} requires battery_capacity")
+    return config
+
+
+def validate_adc_duty_cycle(config):
+    if not config[CONF_ADC_DUTY_CYCLE]:
+        if CONF_ADC_SETTLE_TIME in config:
+            raise cv.Invalid("adc_settle_time requires adc_duty_cycle")
+        return config
+    # Only update() powers the ADCs up, anything reading in between would get stale results
+    if CONF_FAST_SAMPLE_INTERVAL in config:
+        raise cv.Invalid("adc_duty_cycle cannot be combined with fast_sample_interval")
+    for key in CHANNELS:
+        if CONF_UPDATE_INTERVAL in config.get(key, {}):
+            raise cv.Invalid(f"adc_duty_cycle cannot be combined with a per-channel update_interval ({key})")
+    return config
+
+
 CONFIG_SCHEMA = cv.Schema({
     cv.GenerateID(): cv.declare_id(AXP192Component),
     cv.Required(CONF_MODEL): AXP192_MODEL,
@@ -45,44 +284,103 @@ CONFIG_SCHEMA = cv.Schema({
             accuracy_decimals=1,
             icon=ICON_BATTERY,
         ),
-    cv.Optional(CONF_BATTERY_VOLTAGE):
+    cv.Optional(CONF_BATTERY_VOLTAGE): channel_schema(UNIT_VOLT, ICON_BATTERY),
+    cv.Optional(CONF_BATTERY_CURRENT): channel_schema(UNIT_AMPERE, ICON_BATTERY),
+    cv.Optional(CONF_VOLTAGE): channel_schema(UNIT_VOLT, ICON_CURRENT_AC),
+    cv.Optional(CONF_CURRENT): channel_schema(UNIT_AMPERE, ICON_CURRENT_AC),
+    cv.Optional(CONF_VIN_CURRENT): channel_schema(UNIT_AMPERE, ICON_CURRENT_AC),
+    cv.Optional(CONF_TEMPERATURE): channel_schema(UNIT_CELSIUS, ICON_THERMOMETER),
+    cv.Optional(CONF_BRIGHTNESS, default=1.0): cv.percentage,
+    # Battery capacity in mAh, turns battery_level into a coulomb counter fuel gauge
+    cv.Optional(CONF_BATTERY_CAPACITY): cv.positive_float,
+    # Sample the ADCs this often and publish mean/min/max every update_interval
+    cv.Optional(CONF_FAST_SAMPLE_INTERVAL): cv.All(
+        cv.positive_time_period_milliseconds,
+        cv.Range(min=cv.TimePeriod(milliseconds=10)),
+    ),
+    # update() only schedules the acquisition, loop() advances it within this budget per iteration
+    cv.Optional(CONF_LOOP_BUDGET, default="2ms"): cv.positive_time_period_microseconds,
+    # Power the ADCs only around each update's read, after a settle time derived from the sample rate
+    cv.Optional(CONF_ADC_DUTY_CYCLE, default=False): cv.boolean,
+    cv.Optional(CONF_ADC_SETTLE_TIME): cv.All(
+        cv.positive_time_period_milliseconds,
+        cv.Range(max=cv.TimePeriod(seconds=1)),
+    ),
+    cv.Optional(CONF_MAX_LOOP_TIME):
         sensor.sensor_schema(
-            unit_of_measurement=UNIT_VOLT,
-            accuracy_decimals=1,
-            icon=ICON_BATTERY,
+            unit_of_measurement=UNIT_MILLISECOND,
+            accuracy_decimals=2,
+            icon=ICON_TIMER,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
         ),
-    cv.Optional(CONF_BATTERY_CURRENT):
+    cv.Optional(CONF_I2C_MAX_LATENCY):
         sensor.sensor_schema(
-            unit_of_measurement=UNIT_AMPERE,
-            accuracy_decimals=1,
-            icon=ICON_BATTERY,
+            unit_of_measurement=UNIT_MILLISECOND,
+            accuracy_decimals=2,
+            icon=ICON_TIMER,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
         ),
-    cv.Optional(CONF_VOLTAGE):
+    cv.Optional(CONF_IRQ_PIN): pins.internal_gpio_input_pin_schema,
+    # IRQ enable registers 0x40..0x43, most significant byte first
+    cv.Optional(CONF_IRQ_ENABLE_MASK): cv.hex_uint32_t,
+    cv.Optional(CONF_SLEEP_PROFILES): cv.ensure_list(SLEEP_PROFILE_SCHEMA),
+    cv.Optional(CONF_CHARGE_CONTROLLER): CHARGE_CONTROLLER_SCHEMA,
+    cv.Optional(CONF_HISTORY): HISTORY_SCHEMA,
+    cv.Optional(CONF_LOW_BATTERY_SHUTDOWN): LOW_BATTERY_SHUTDOWN_SCHEMA,
+    cv.Optional(CONF_TRACE): TRACE_SCHEMA,
+    # Energy totals are written to flash at most this often, RTC memory bridges deep sleep in between
+    cv.Optional(CONF_ENERGY_COMMIT_INTERVAL, default="1h"): cv.All(
+        cv.positive_time_period_milliseconds,
+        cv.Range(min=cv.TimePeriod(minutes=1)),
+    ),
+}).extend({
+    cv.Optional(key):
         sensor.sensor_schema(
-            unit_of_measurement=UNIT_VOLT,
-            accuracy_decimals=1,
-            icon=ICON_CURRENT_AC,
-        ),
-    cv.Optional(CONF_CURRENT):
+            unit_of_measurement=UNIT_WATT_HOURS,
+            accuracy_decimals=3,
+            icon=ICON_FLASH,
+            device_class=DEVICE_CLASS_ENERGY,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+        ) for key in ENERGY_COUNTERS
+}).extend({
+    cv.Optional(key):
         sensor.sensor_schema(
-            unit_of_measurement=UNIT_AMPERE,
-            accuracy_decimals=1,
-            icon=ICON_CURRENT_AC,
-        ),
-    cv.Optional(CONF_VIN_CURRENT):
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ) for key in I2C_COUNTERS
+}).extend({
+    cv.Optional(key):
         sensor.sensor_schema(
-            unit_of_measurement=UNIT_AMPERE,
-            accuracy_decimals=1,
-            icon=ICON_CURRENT_AC,
-        ),
-    cv.Optional(CONF_TEMPERATURE):
-        sensor.sensor_schema(
-            unit_of_measurement=UNIT_CELSIUS,
-            accuracy_decimals=1,
-            icon=ICON_THERMOMETER,
-        ),
-    cv.Optional(CONF_BRIGHTNESS, default=1.0): cv.percentage,
+            unit_of_measurement=UNIT_MINUTE,
+            accuracy_decimals=0,
+            icon=ICON_TIMER,
+            device_class=DEVICE_CLASS_DURATION,
+        ) for key in RUNTIME_SENSORS
+}).extend({
+    cv.Optional(key): automation.validate_automation({
+        cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(AXP192EventTrigger),
+    }) for key in EVENT_TRIGGERS
 }).extend(cv.polling_component_schema('60s')).extend(i2c.i2c_device_schema(0x77))
+CONFIG_SCHEMA = cv.All(CONFIG_SCHEMA, validate_sleep_profiles, validate_runtime, validate_adc_duty_cycle,
+                       validate_low_battery_shutdown)
+
+
+def config_hash(config):
+    """32 bit hash of the validated config and this component's sources, the same for every build of both."""
+    def plain(value):
+        if isinstance(value, dict):
+            return {str(k): plain(v) for k, v in value.items()}
+        if isinstance(value, (list, tuple)):
+            return [plain(v) for v in value]
+        if value is None or isinstance(value, (bool, int, float, str)):
+            return value
+        return str(value)
+
+    digest = hashlib.sha256(json.dumps(plain(config), sort_keys=True).encode())
+    for source in sorted(Path(__file__).parent.glob("*.[ch]*")):
+        digest.update(source.read_bytes())
+    return int.from_bytes(digest.digest()[:4], "little")
 
 
 def to_code(config):
@@ -90,11 +388,40 @@ def to_code(config):
     yield cg.register_component(var, config)
     yield i2c.register_i2c_device(var, config)
 
-    cg.add(var.set_model(config[CONF_MODEL]))
+    # The model selects a compile-time traits specialisation, see AXP192ModelTraits
+    cg.add_define("AXP192_MODEL", MODELS[config[CONF_MODEL]])
+    # A fast wake skips begin(), only when neither the config nor the component changed since the sleep
+    cg.add_define("AXP192_CONFIG_HASH", f"0x{config_hash(config):08X}UL")
 
     if CONF_MAX_CURRENT in config:
         cg.add(var.set_charge_current(config[CONF_MAX_CURRENT]))
 
+    if CONF_CHARGE_CONTROLLER in config:
+        conf = config[CONF_CHARGE_CONTROLLER]
+        cg.add(var.set_charge_controller(conf[CONF_MAX_CURRENT], conf[CONF_VBUS_CURRENT_LIMIT],
+                                         conf[CONF_VBUS_MIN_VOLTAGE], conf[CONF_MAX_TEMPERATURE]))
+
+    if CONF_HISTORY in config:
+        conf = config[CONF_HISTORY]
+        # The ring lives in RTC memory, so its size is fixed at compile time
+        cg.add_define("AXP192_HISTORY_BLOCKS", conf[CONF_BLOCKS])
+        cg.add(var.set_history_interval(conf[CONF_INTERVAL]))
+
+    if CONF_TRACE in config:
+        # Without the define every trace point compiles to nothing
+        cg.add_define("AXP192_TRACE_RECORDS", config[CONF_TRACE][CONF_RECORDS])
+
+    if CONF_LOW_BATTERY_SHUTDOWN in config:
+        conf = config[CONF_LOW_BATTERY_SHUTDOWN]
+        cg.add(var.set_low_battery_shutdown(conf[CONF_WARNING_VOLTAGE], conf[CONF_SHUTDOWN_VOLTAGE],
+                                            conf[CONF_POLL_INTERVAL], conf[CONF_DEADLINE],
+                                            conf[CONF_ACTION] == "DEEP_SLEEP"))
+        if CONF_PROFILE in conf:
+            cg.add(var.set_low_battery_shutdown_profile(conf[CONF_PROFILE]))
+        for trigger_conf in conf.get(CONF_ON_SHUTDOWN, []):
+            trigger = cg.new_Pvariable(trigger_conf[CONF_TRIGGER_ID], var)
+            yield automation.build_automation(trigger, [], trigger_conf)
+
     if CONF_BATTERY_LEVEL in config:
         conf = config[CONF_BATTERY_LEVEL]
         sens = yield sensor.new_sensor(conf)
@@ -130,6 +457,83 @@ def to_code(config):
         sens = yield sensor.new_sensor(conf)
         cg.add(var.set_temperature_sensor(sens))
 
+    for key, channel in CHANNELS.items():
+        if key not in config:
+            continue
+        if CONF_UPDATE_INTERVAL in config[key]:
+            cg.add(var.set_channel_update_interval(channel, config[key][CONF_UPDATE_INTERVAL]))
+        if CONF_MIN in config[key]:
+            sens = yield sensor.new_sensor(config[key][CONF_MIN])
+            cg.add(var.set_channel_min_sensor(channel, sens))
+        if CONF_MAX in config[key]:
+            sens = yield sensor.new_sensor(config[key][CONF_MAX])
+            cg.add(var.set_channel_max_sensor(channel, sens))
+
+    if CONF_FAST_SAMPLE_INTERVAL in config:
+        cg.add(var.set_fast_sample_interval(config[CONF_FAST_SAMPLE_INTERVAL]))
+
+    cg.add(var.set_loop_budget(config[CONF_LOOP_BUDGET]))
+
+    if config[CONF_ADC_DUTY_CYCLE]:
+        cg.add(var.set_adc_duty_cycle(True, config.get(CONF_ADC_SETTLE_TIME, 0)))
+
+    if CONF_MAX_LOOP_TIME in config:
+        sens = yield sensor.new_sensor(config[CONF_MAX_LOOP_TIME])
+        cg.add(var.set_loop_time_sensor(sens))
+
+    for key, setter in I2C_COUNTERS.items():
+        if key in config:
+            sens = yield sensor.new_sensor(config[key])
+            cg.add(getattr(var, setter)(sens))
+
+    if CONF_I2C_MAX_LATENCY in config:
+        sens = yield sensor.new_sensor(config[CONF_I2C_MAX_LATENCY])
+        cg.add(var.set_i2c_latency_sensor(sens))
+
+    for key, counter in ENERGY_COUNTERS.items():
+        if key in config:
+            sens = yield sensor.new_sensor(config[key])
+            cg.add(var.set_energy_sensor(counter, sens))
+    cg.add(var.set_energy_commit_interval(config[CONF_ENERGY_COMMIT_INTERVAL]))
+
     if CONF_BRIGHTNESS in config:
         conf = config[CONF_BRIGHTNESS]
         cg.add(var.set_brightness(conf))
+
+    if CONF_BATTERY_CAPACITY in config:
+        cg.add(var.set_battery_capacity(config[CONF_BATTERY_CAPACITY]))
+
+    for key, setter in RUNTIME_SENSORS.items():
+        if key in config:
+            sens = yield sensor.new_sensor(config[key])
+            cg.add(getattr(var, setter)(sens))
+
+    if CONF_IRQ_PIN in config:
+        pin = yield cg.gpio_pin_expression(config[CONF_IRQ_PIN])
+        cg.add(var.set_irq_pin(pin))
+
+    if CONF_IRQ_ENABLE_MASK in config:
+        cg.add(var.set_irq_enable_mask(config[CONF_IRQ_ENABLE_MASK]))
+
+    for profile in config.get(CONF_SLEEP_PROFILES, []):
+        rails = 0
+        for rail in profile[CONF_RAILS]:
+            rails |= SLEEP_RAILS[rail]
+        adc_channels = 0
+        for channel in profile[CONF_ADC_CHANNELS]:
+            adc_channels |= SLEEP_ADC_CHANNELS[channel]
+        wake_pins = 0
+        for pin in profile[CONF_WAKE_PINS]:
+            wake_pins |= 1 << pin
+        charge_current = profile[CONF_MAX_CURRENT] if CONF_MAX_CURRENT in profile else -1
+        irq_mask = profile.get(CONF_IRQ_ENABLE_MASK, -1)
+        cg.add(var.add_sleep_profile(profile[CONF_NAME], rails, adc_channels,
+                                     cg.RawExpression(f"0x{wake_pins:X}ULL"),
+                                     profile[CONF_WAKE_PIN_MODE] == "ANY_HIGH",
+                                     profile[CONF_WAKE_ON_IRQ], charge_current,
+                                     cg.RawExpression(f"0x{irq_mask:X}LL" if irq_mask >= 0 else "-1")))
+
+    for key, event in EVENT_TRIGGERS.items():
+        for conf in config.get(key, []):
+            trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var, event)
+            yield automation.build_automation(trigger, [], conf)
@@ -0,0 +1,21 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import switch
+from esphome.const import CONF_ID
+from . import axp192_ns, AXP192Component, CONF_AXP192_ID, CONF_RAIL, RAILS, validate_rail
+
+AXP192RailSwitch = axp192_ns.class_("AXP192RailSwitch", switch.Switch, cg.Component)
+
+CONFIG_SCHEMA = switch.SWITCH_SCHEMA.extend({
+    cv.GenerateID(): cv.declare_id(AXP192RailSwitch),
+    cv.GenerateID(CONF_AXP192_ID): cv.use_id(AXP192Component),
+    cv.Required(CONF_RAIL): validate_rail,
+}).extend(cv.COMPONENT_SCHEMA)
+
+
+def to_code(config):
+    var = cg.new_Pvariable(config[CONF_ID])
+    yield cg.register_component(var, config)
+    yield switch.register_switch(var, config)
+    yield cg.register_parented(var, config[CONF_AXP192_ID])
+    cg.add(var.set_rail(RAILS[config[CONF_RAIL]][0]))
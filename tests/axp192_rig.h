@@ -0,0 +1,217 @@
+#pragma once
+// The component is compiled into the test itself, so its RTC memory and protected state are reachable
+#include "axp192.cpp"
+#include "backlight.h"
+#include "rails.h"
+#include "esphome/components/binary_sensor/binary_sensor.h"
+#include "axp192_model.h"
+#include "sim.h"
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace esphome
+{
+    namespace axp192
+    {
+        // The component with its internals opened up for inspection
+        class TestAXP192 : public AXP192Component
+        {
+        public:
+            using AXP192Component::adc_block_first_;
+            using AXP192Component::adc_block_last_;
+            using AXP192Component::adc_channels_;
+            using AXP192Component::adc_powered_;
+            using AXP192Component::adc_rate_;
+            using AXP192Component::AdcIdleChannels;
+            using AXP192Component::AdcSettleTime;
+            using AXP192Component::begin;
+            using AXP192Component::charge_step_;
+            using AXP192Component::ConfigSignature;
+            using AXP192Component::energy_;
+            using AXP192Component::fast_wake_;
+            using AXP192Component::fuel_charge_mah_;
+            using AXP192Component::fuel_gauge_ready_;
+            using AXP192Component::GetBatState;
+            using AXP192Component::OcvToSoc;
+            using AXP192Component::reg_cache_valid_;
+            using AXP192Component::runtime_current_ma_;
+            using AXP192Component::ServiceIrq;
+            using AXP192Component::update_state_;
+#ifdef AXP192_TRACE_RECORDS
+            using AXP192Component::trace_;
+            using AXP192Component::trace_total_;
+#endif
+        };
+
+        // RTC memory after the battery was pulled: whatever the cells power up with
+        inline void lose_rtc_memory()
+        {
+            memset(&fuel_gauge_rtc, 0x5A, sizeof(fuel_gauge_rtc));
+            memset(&energy_rtc, 0x5A, sizeof(energy_rtc));
+            memset(&wake_rtc, 0x5A, sizeof(wake_rtc));
+#ifdef AXP192_HISTORY_BLOCKS
+            memset(&history_rtc, 0x5A, sizeof(history_rtc));
+#endif
+        }
+    }
+}
+
+namespace sim
+{
+    using esphome::axp192::TestAXP192;
+
+    // One device: the PMIC, which outlives ESP reboots, and the component of the current boot.
+    // configure runs on every boot before setup(), like the code generated from the YAML.
+    class Rig
+    {
+    public:
+        using Configure = std::function<void(Rig &, TestAXP192 &)>;
+
+        explicit Rig(Configure configure = nullptr) : configure_(configure)
+        {
+            world_us = 0;
+            flash.clear();
+            flash_writes = 0;
+            flash_fail = false;
+            light_sleeps = 0;
+            esphome::App.safe_shutdown_hooks_run = 0;
+            log_clear();
+            esphome::axp192::lose_rtc_memory();
+            pmic.power_on();
+        }
+
+        // A fresh component, configured and set up, after an ESP reset of the given kind
+        TestAXP192 &boot(esp_reset_reason_t reason = ESP_RST_POWERON, esp_sleep_wakeup_cause_t cause = ESP_SLEEP_WAKEUP_UNDEFINED)
+        {
+            // ROM and bootloader; the PMIC keeps converting meanwhile
+            advance_ms(reason == ESP_RST_DEEPSLEEP ? ESP_WAKE_MS : ESP_BOOT_MS);
+            reboot(reason, cause);
+            sensors.clear();
+            binary_sensors.clear();
+            axp.reset(new TestAXP192());
+            axp->set_i2c_target(&pmic);
+            axp->set_update_interval(60000);
+            axp->set_charge_current(esphome::axp192::CURRENT_100MA);
+            if (configure_)
+                configure_(*this, *axp);
+            BusStats before = pmic.stats;
+            axp->setup();
+            setup_stats.transactions = pmic.stats.transactions - before.transactions;
+            setup_stats.bytes = pmic.stats.bytes - before.bytes;
+            setup_stats.bus_us = pmic.stats.bus_us - before.bus_us;
+            setup_ms = esphome::millis();
+            // Application::setup() keeps looping the components set up so far, without the loop interval, until
+            // this one lets the next one start
+            while (!axp->can_proceed())
+            {
+                advance_ms(1);
+                loop_once();
+            }
+            next_update_ = esphome::millis();
+            return *axp;
+        }
+
+        esphome::sensor::Sensor *sensor(const std::string &name)
+        {
+            auto &slot = sensors[name];
+            if (!slot)
+                slot.reset(new esphome::sensor::Sensor());
+            return slot.get();
+        }
+        esphome::binary_sensor::BinarySensor *binary_sensor(const std::string &name)
+        {
+            auto &slot = binary_sensors[name];
+            if (!slot)
+                slot.reset(new esphome::binary_sensor::BinarySensor());
+            return slot.get();
+        }
+        float state(const std::string &name) { return sensor(name)->state; }
+
+        // One main loop iteration: the IRQ line, the scheduler and loop()
+        void loop_once()
+        {
+            bool asserted = pmic.irq_asserted();
+            if (asserted && irq_pin.digital_read())
+            {
+                irq_pin.set_level(false);
+                irq_pin.trigger_interrupt();
+            }
+            else if (!asserted)
+            {
+                irq_pin.set_level(true);
+            }
+            axp->run_scheduler();
+            axp->loop();
+            if (!pmic.irq_asserted())
+                irq_pin.set_level(true);
+        }
+
+        // update() and loop() until the acquisition is done
+        void poll()
+        {
+            axp->update();
+            loop_once();
+            while (axp->update_state_ != esphome::axp192::UPDATE_IDLE)
+            {
+                advance_us(loop_period_us);
+                loop_once();
+            }
+        }
+
+        // Main loop for ms of simulated time, with update() on the component's interval
+        void run_for(uint32_t ms)
+        {
+            uint64_t end = world_us + ms * 1000ULL;
+            while (world_us < end)
+            {
+                if ((int32_t) (esphome::millis() - next_update_) >= 0)
+                {
+                    next_update_ += axp->get_update_interval();
+                    axp->update();
+                }
+                loop_once();
+                advance_us(loop_period_us);
+            }
+        }
+
+        // Runs f, which must end in esp_deep_sleep_start(), then sleeps for the armed timer (or sleep_ms) and wakes
+        template <typename F>
+        bool deep_sleep(F &&f, uint32_t sleep_ms = 0)
+        {
+            try
+            {
+                f();
+            }
+            catch (const DeepSleep &sleep)
+            {
+                uint64_t us = sleep.timer_us > 0 ? sleep.timer_us : sleep_ms * 1000ULL;
+                axp.reset();
+                advance_us(us);
+                boot(ESP_RST_DEEPSLEEP, sleep.timer_us > 0 ? ESP_SLEEP_WAKEUP_TIMER : ESP_SLEEP_WAKEUP_EXT1);
+                return true;
+            }
+            return false;
+        }
+
+        AXP192Model pmic;
+        esphome::InternalGPIOPin irq_pin{35};
+        std::unique_ptr<TestAXP192> axp;
+        std::map<std::string, std::unique_ptr<esphome::sensor::Sensor>> sensors;
+        std::map<std::string, std::unique_ptr<esphome::binary_sensor::BinarySensor>> binary_sensors;
+        uint64_t loop_period_us{16000};
+        // Bus cost of the last setup()
+        BusStats setup_stats;
+        // Time from the reset to setup() returning, before the components after it could start
+        uint32_t setup_ms{0};
+
+        static const uint32_t ESP_BOOT_MS = 300;
+        static const uint32_t ESP_WAKE_MS = 50;
+
+    protected:
+        Configure configure_;
+        uint32_t next_update_{0};
+    };
+}
@@ -0,0 +1,192 @@
+// Bus cost of setup(), update() and every setter against the simulated PMIC, as CSV on stdout.
+// With a budget file as argument, exits non-zero when any operation costs more than its budget row.
+#include "axp192_rig.h"
+#include <fstream>
+#include <sstream>
+
+using namespace esphome;
+using namespace esphome::axp192;
+using sim::BusStats;
+using sim::Rig;
+
+struct Row
+{
+    std::string config;
+    std::string operation;
+    uint32_t transactions;
+    uint32_t bytes;
+    uint64_t bus_us;
+};
+
+static std::vector<Row> rows;
+
+static void record(const char *config, const char *operation, uint32_t transactions, uint32_t bytes, uint64_t bus_us)
+{
+    rows.push_back({config, operation, transactions, bytes, bus_us});
+}
+
+// Cost of whatever f sends, including a deep sleep entry that never returns
+template <typename F>
+static void measure(Rig &rig, const char *config, const char *operation, F &&f)
+{
+    BusStats before = rig.pmic.stats;
+    try
+    {
+        f();
+    }
+    catch (const sim::DeepSleep &)
+    {
+    }
+    record(config, operation, rig.pmic.stats.transactions - before.transactions, rig.pmic.stats.bytes - before.bytes,
+           rig.pmic.stats.bus_us - before.bus_us);
+}
+
+static void record_setup(Rig &rig, const char *config, const char *operation)
+{
+    record(config, operation, rig.setup_stats.transactions, rig.setup_stats.bytes, rig.setup_stats.bus_us);
+}
+
+// The sample configurations: battery level only
+static void battery_level_config(Rig &rig, TestAXP192 &axp)
+{
+    axp.set_batterylevel_sensor(rig.sensor("battery_level"));
+}
+
+// Every feature that adds bus traffic
+static void full_config(Rig &rig, TestAXP192 &axp)
+{
+    axp.set_batterylevel_sensor(rig.sensor("battery_level"));
+    axp.set_batteryvoltage_sensor(rig.sensor("battery_voltage"));
+    axp.set_batterycurrent_sensor(rig.sensor("battery_current"));
+    axp.set_vbusvoltage_sensor(rig.sensor("vbus_voltage"));
+    axp.set_vbuscurrent_sensor(rig.sensor("vbus_current"));
+    axp.set_vincurrent_sensor(rig.sensor("vin_current"));
+    axp.set_temperature_sensor(rig.sensor("temperature"));
+    axp.set_battery_capacity(1000.0f);
+    axp.set_time_to_empty_sensor(rig.sensor("time_to_empty"));
+    axp.set_energy_sensor(ENERGY_BAT_DISCHARGE, rig.sensor("battery_discharge_energy"));
+    axp.set_energy_sensor(ENERGY_VBUS, rig.sensor("vbus_energy"));
+    axp.set_charge_controller(CURRENT_450MA, 0.5f, 4.5f, 70.0f);
+    axp.set_irq_pin(&rig.irq_pin);
+    axp.set_vbus_binary_sensor(rig.binary_sensor("vbus"));
+    axp.set_charging_binary_sensor(rig.binary_sensor("charging"));
+    axp.set_low_battery_shutdown(3.45f, 3.3f, 1000, 2000, false);
+}
+
+static void bench_config(const char *config, Rig::Configure configure)
+{
+    Rig rig(configure);
+    rig.boot();
+    record_setup(rig, config, "setup (cold boot)");
+    measure(rig, config, "update (first)", [&]() { rig.poll(); });
+    sim::advance_ms(60000);
+    measure(rig, config, "update", [&]() { rig.poll(); });
+    measure(rig, config, "DeepSleep (entry)", [&]() { rig.axp->DeepSleep(SLEEP_SEC(60)); });
+    sim::advance_ms(60000);
+    rig.boot(ESP_RST_DEEPSLEEP, ESP_SLEEP_WAKEUP_TIMER);
+    record_setup(rig, config, "setup (deep sleep wake)");
+}
+
+static void bench_setters()
+{
+    const char *config = "battery_level";
+    Rig rig(battery_level_config);
+    TestAXP192 &axp = rig.boot();
+
+    measure(rig, config, "set_brightness (change)", [&]() { axp.set_brightness(0.5f); });
+    measure(rig, config, "set_brightness (same)", [&]() { axp.set_brightness(0.5f); });
+    measure(rig, config, "set_brightness (zero)", [&]() { axp.set_brightness(0.0f); });
+    measure(rig, config, "SetChargeCurrent", [&]() { axp.SetChargeCurrent(CURRENT_450MA); });
+    measure(rig, config, "SetLDO2", [&]() { axp.SetLDO2(false); });
+    measure(rig, config, "SetLDO3", [&]() { axp.SetLDO3(true); });
+    measure(rig, config, "SetRailEnabled", [&]() { axp.SetRailEnabled(RAIL_LDOIO0, false); });
+    measure(rig, config, "SetRailVoltage", [&]() { axp.SetRailVoltage(RAIL_DCDC2, 1200); });
+    measure(rig, config, "GetRailVoltage", [&]() { axp.GetRailVoltage(RAIL_DCDC2); });
+    measure(rig, config, "SetAdcState (off)", [&]() { axp.SetAdcState(false); });
+    measure(rig, config, "SetAdcState (on)", [&]() { axp.SetAdcState(true); });
+    measure(rig, config, "GetBatVoltage", [&]() { axp.GetBatVoltage(); });
+    measure(rig, config, "GetBatCoulombInput", [&]() { axp.GetBatCoulombInput(); });
+    measure(rig, config, "SetCoulombClear", [&]() { axp.SetCoulombClear(); });
+    measure(rig, config, "ResyncRegisters", [&]() { axp.ResyncRegisters(); });
+    rig.pmic.press_button(false);
+    measure(rig, config, "ServiceIrq (one event)", [&]() { axp.ServiceIrq(); });
+    measure(rig, config, "ServiceIrq (nothing pending)", [&]() { axp.ServiceIrq(); });
+    measure(rig, config, "LightSleep (round trip)", [&]() { axp.LightSleep(SLEEP_SEC(1)); });
+    measure(rig, config, "SetSleep", [&]() { axp.SetSleep(); });
+    measure(rig, config, "PowerOff", [&]() { axp.PowerOff(); });
+}
+
+static std::string key(const std::string &config, const std::string &operation)
+{
+    return config + "," + operation;
+}
+
+// Compares against the budget rows for this model, reports every regression
+static bool check_budget(const char *path)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        fprintf(stderr, "Cannot read %s\n", path);
+        return false;
+    }
+    std::map<std::string, Row> budget;
+    std::string line;
+    std::getline(file, line);
+    while (std::getline(file, line))
+    {
+        std::stringstream fields(line);
+        std::string model, config, operation, transactions, bytes, bus_us;
+        if (!std::getline(fields, model, ',') || !std::getline(fields, config, ',') || !std::getline(fields, operation, ',') ||
+            !std::getline(fields, transactions, ',') || !std::getline(fields, bytes, ',') || !std::getline(fields, bus_us, ','))
+            continue;
+        if (model == ModelTraits::NAME)
+            budget[key(config, operation)] = {config, operation, (uint32_t) std::stoul(transactions),
+                                              (uint32_t) std::stoul(bytes), std::stoull(bus_us)};
+    }
+
+    bool ok = true;
+    for (const Row &row : rows)
+    {
+        auto it = budget.find(key(row.config, row.operation));
+        if (it == budget.end())
+        {
+            fprintf(stderr, "%s: no budget for %s / %s, run make budget\n", ModelTraits::NAME, row.config.c_str(),
+                    row.operation.c_str());
+            ok = false;
+            continue;
+        }
+        const Row &limit = it->second;
+        if (row.transactions > limit.transactions || row.bytes > limit.bytes || row.bus_us > limit.bus_us)
+        {
+            fprintf(stderr, "%s: %s / %s regressed: %u transactions, %u bytes, %llu us (budget %u, %u, %llu)\n",
+                    ModelTraits::NAME, row.config.c_str(), row.operation.c_str(), (unsigned) row.transactions,
+                    (unsigned) row.bytes, (unsigned long long) row.bus_us, (unsigned) limit.transactions,
+                    (unsigned) limit.bytes, (unsigned long long) limit.bus_us);
+            ok = false;
+        }
+        else if (row.transactions < limit.transactions || row.bytes < limit.bytes)
+        {
+            fprintf(stderr, "%s: %s / %s is below budget, run make budget to lock it in\n", ModelTraits::NAME,
+                    row.config.c_str(), row.operation.c_str());
+        }
+    }
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    bench_config("battery_level", battery_level_config);
+    bench_config("full", full_config);
+    bench_setters();
+
+    printf("model,config,operation,transactions,bytes,bus_us\n");
+    for (const Row &row : rows)
+    {
+        printf("%s,%s,%s,%u,%u,%llu\n", ModelTraits::NAME, row.config.c_str(), row.operation.c_str(),
+               (unsigned) row.transactions, (unsigned) row.bytes, (unsigned long long) row.bus_us);
+    }
+    if (argc > 1 && !check_budget(argv[1]))
+        return 1;
+    return 0;
+}
@@ -0,0 +1,315 @@
+#include "axp192_model.h"
+#include "sim.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using esphome::i2c::ErrorCode;
+
+namespace sim
+{
+    // ADC result registers per enable bit of 0x82/0x83 (bit 15 first): high byte, width and LSB
+    struct AdcChannel
+    {
+        uint8_t reg;
+        uint8_t bits;
+        float lsb;
+    };
+    static const AdcChannel ADC_CHANNELS[16] = {
+        {0x78, 12, 1.1f},   // 0x82 bit 7: battery voltage, mV
+        {0x7A, 13, 0.5f},   // 0x82 bit 6: battery charge and discharge current, mA
+        {0x56, 12, 1.7f},   // 0x82 bit 5: VIN voltage, mV
+        {0x58, 12, 0.625f}, // 0x82 bit 4: VIN current, mA
+        {0x5A, 12, 1.7f},   // 0x82 bit 3: VBUS voltage, mV
+        {0x5C, 12, 0.375f}, // 0x82 bit 2: VBUS current, mA
+        {0x7E, 12, 1.4f},   // 0x82 bit 1: APS voltage, mV
+        {0x62, 12, 0.8f},   // 0x82 bit 0: TS pin, mV
+        {0x5E, 12, 0.1f},   // 0x83 bit 7: internal temperature, 0.1°C from -144.7°C
+    };
+
+    static void put_raw(uint8_t *result, uint8_t bits, float value, float lsb)
+    {
+        int32_t max = (1 << bits) - 1;
+        int32_t raw = lroundf(value / lsb);
+        raw = raw < 0 ? 0 : (raw > max ? max : raw);
+        if (bits == 13)
+        {
+            result[0] = raw >> 5;
+            result[1] = raw & 0x1F;
+        }
+        else
+        {
+            result[0] = raw >> 4;
+            result[1] = raw & 0x0F;
+        }
+    }
+
+    void AXP192Model::power_on()
+    {
+        memset(regs_, 0, sizeof(regs_));
+        regs_[0x12] = 0x01; // DCDC1 only, the rest is up to the firmware
+        regs_[0x23] = 0x16;
+        regs_[0x26] = 0x68;
+        regs_[0x27] = 0x68;
+        regs_[0x30] = 0x60;
+        regs_[0x31] = 0x03;
+        regs_[0x32] = 0x46;
+        regs_[0x33] = 0xC8;
+        regs_[0x35] = 0x22;
+        regs_[0x36] = 0x5D;
+        regs_[0x3A] = 0x68;
+        regs_[0x3B] = 0x5F;
+        regs_[0x40] = 0xD8;
+        regs_[0x41] = 0xFF;
+        regs_[0x42] = 0x3B;
+        regs_[0x43] = 0xC1;
+        regs_[0x82] = 0x83;
+        regs_[0x83] = 0x80;
+        regs_[0x84] = 0x32;
+        regs_[0x90] = 0x07;
+        coulomb_in_ = 0.0;
+        coulomb_out_ = 0.0;
+        last_sync_us_ = world_us;
+        latched_ = inputs_;
+        // The default channels have been converting since the battery went in
+        for (uint8_t i = 0; i < 16; i++)
+        {
+            enabled_at_[i] = world_us;
+            if (i < 9 && (adc_enables() & (0x8000 >> i)))
+                convert(i);
+        }
+    }
+
+    void AXP192Model::power_key()
+    {
+        uint8_t buffer[6];
+        memcpy(buffer, &regs_[0x06], sizeof(buffer));
+        double in = coulomb_in_, out = coulomb_out_;
+        uint8_t counter = regs_[0xB8];
+        power_on();
+        memcpy(&regs_[0x06], buffer, sizeof(buffer));
+        coulomb_in_ = in;
+        coulomb_out_ = out;
+        regs_[0xB8] = counter;
+    }
+
+    void AXP192Model::account(size_t bytes, bool failed)
+    {
+        stats.transactions++;
+        stats.bytes += bytes;
+        uint32_t us = TRANSACTION_OVERHEAD_US + lroundf(bytes * 9 * BIT_US);
+        stats.bus_us += us;
+        if (failed)
+            stats.failures++;
+        advance_us(us);
+    }
+
+    ErrorCode AXP192Model::read_register(uint8_t a_register, uint8_t *data, size_t len)
+    {
+        sync();
+        if (fail_next > 0 || a_register == fail_reads_at)
+        {
+            if (fail_next > 0)
+                fail_next--;
+            account(1, true);
+            return esphome::i2c::ERROR_NOT_ACKNOWLEDGED;
+        }
+        // Address + register, repeated start, address + data
+        account(3 + len, false);
+        stats.reads++;
+        for (size_t i = 0; i < len; i++)
+        {
+            data[i] = regs_[(uint8_t) (a_register + i)];
+        }
+        return esphome::i2c::ERROR_OK;
+    }
+
+    ErrorCode AXP192Model::write(const uint8_t *data, size_t len)
+    {
+        sync();
+        if (fail_next > 0 || len < 2 || len % 2 != 0 || (reject_multi_write && len > 2))
+        {
+            if (fail_next > 0)
+                fail_next--;
+            account(1, true);
+            return esphome::i2c::ERROR_NOT_ACKNOWLEDGED;
+        }
+        account(1 + len, false);
+        stats.writes++;
+        // One register, or address/value pairs
+        for (size_t i = 0; i < len; i += 2)
+        {
+            stats.register_writes[data[i]]++;
+            write_register(data[i], data[i + 1]);
+        }
+        return esphome::i2c::ERROR_OK;
+    }
+
+    void AXP192Model::write_register(uint8_t addr, uint8_t value)
+    {
+        switch (addr)
+        {
+        case 0x44:
+        case 0x45:
+        case 0x46:
+        case 0x47:
+        case 0x4D:
+            regs_[addr] &= ~value;
+            break;
+        case 0x82:
+            set_enables((value << 8) | regs_[0x83]);
+            break;
+        case 0x83:
+            set_enables((regs_[0x82] << 8) | value);
+            break;
+        case 0xB8:
+            if (value & 0x20)
+            {
+                coulomb_in_ = 0.0;
+                coulomb_out_ = 0.0;
+                memset(&regs_[0xB0], 0, 8);
+            }
+            regs_[addr] = value & ~0x20;
+            break;
+        default:
+            regs_[addr] = value;
+            break;
+        }
+    }
+
+    void AXP192Model::set_enables(uint16_t enables)
+    {
+        uint16_t before = adc_enables();
+        for (uint8_t i = 0; i < 16; i++)
+        {
+            uint16_t bit = 0x8000 >> i;
+            if ((enables & bit) && !(before & bit))
+                enabled_at_[i] = world_us;
+        }
+        regs_[0x82] = enables >> 8;
+        regs_[0x83] = enables & 0xff;
+    }
+
+    void AXP192Model::convert(uint8_t channel)
+    {
+        const AdcChannel &c = ADC_CHANNELS[channel];
+        uint8_t *result = &regs_[c.reg];
+        switch (channel)
+        {
+        case 0:
+            put_raw(result, c.bits, inputs_.bat_mv, c.lsb);
+            // Battery power, 24 bit product of the voltage and current results
+            {
+                uint32_t v = (regs_[0x78] << 4) | (regs_[0x79] & 0x0F);
+                uint32_t i = std::max((regs_[0x7A] << 5) | (regs_[0x7B] & 0x1F), (regs_[0x7C] << 5) | (regs_[0x7D] & 0x1F));
+                uint32_t p = v * i;
+                regs_[0x70] = p >> 16;
+                regs_[0x71] = p >> 8;
+                regs_[0x72] = p;
+            }
+            break;
+        case 1:
+            put_raw(&regs_[0x7A], 13, inputs_.bat_ma > 0 ? inputs_.bat_ma : 0.0f, c.lsb);
+            put_raw(&regs_[0x7C], 13, inputs_.bat_ma < 0 ? -inputs_.bat_ma : 0.0f, c.lsb);
+            break;
+        case 2:
+            put_raw(result, c.bits, inputs_.vin_mv, c.lsb);
+            break;
+        case 3:
+            put_raw(result, c.bits, inputs_.vin_ma, c.lsb);
+            break;
+        case 4:
+            put_raw(result, c.bits, inputs_.vbus_mv, c.lsb);
+            break;
+        case 5:
+            put_raw(result, c.bits, inputs_.vbus_ma, c.lsb);
+            break;
+        case 6:
+            put_raw(result, c.bits, inputs_.aps_mv, c.lsb);
+            break;
+        case 7:
+            put_raw(result, c.bits, inputs_.ts_mv, c.lsb);
+            break;
+        case 8:
+            put_raw(result, c.bits, inputs_.temp_c + 144.7f, c.lsb);
+            break;
+        default:
+            break;
+        }
+    }
+
+    void AXP192Model::sync()
+    {
+        uint64_t now = world_us;
+        if (now < last_sync_us_)
+            return;
+        uint64_t period = 1000000 / adc_rate_hz();
+        uint16_t enables = adc_enables();
+
+        // Conversions since the last sync; inputs only change at sync points, so the latest one decides
+        for (uint8_t i = 0; i < 9; i++)
+        {
+            if (!(enables & (0x8000 >> i)))
+                continue;
+            uint64_t first = enabled_at_[i] + period + first_conversion_delay_us;
+            if (now < first)
+                continue;
+            uint64_t latest = first + (now - first) / period * period;
+            if (latest > last_sync_us_)
+                convert(i);
+        }
+
+        // Coulomb counter
+        bool counting = (regs_[0xB8] & 0x80) && !(regs_[0xB8] & 0x40) && (enables & 0x4000);
+        if (counting && now > last_sync_us_)
+        {
+            double counts = fabs(inputs_.bat_ma) * adc_rate_hz() / 32768.0 * (now - last_sync_us_) / 1e6;
+            if (inputs_.bat_ma > 0)
+                coulomb_in_ += counts;
+            else
+                coulomb_out_ += counts;
+            uint32_t in = (uint32_t) coulomb_in_;
+            uint32_t out = (uint32_t) coulomb_out_;
+            for (uint8_t b = 0; b < 4; b++)
+            {
+                regs_[0xB0 + b] = in >> (24 - 8 * b);
+                regs_[0xB4 + b] = out >> (24 - 8 * b);
+            }
+        }
+
+        // Status registers and edge-triggered IRQs
+        if (inputs_.vbus_present != latched_.vbus_present)
+            regs_[0x44] |= inputs_.vbus_present ? (1 << 3) : (1 << 2);
+        if (inputs_.charging != latched_.charging)
+            regs_[0x45] |= inputs_.charging ? (1 << 3) : (1 << 2);
+        // APS low voltage levels: 2.8672V + 5.6mV per code
+        float warning_mv = 2867.2f + 5.6f * regs_[0x3A];
+        float shutdown_mv = 2867.2f + 5.6f * regs_[0x3B];
+        if (inputs_.aps_mv < warning_mv && latched_.aps_mv >= warning_mv)
+            regs_[0x47] |= (1 << 1);
+        if (inputs_.aps_mv < shutdown_mv && latched_.aps_mv >= shutdown_mv)
+            regs_[0x47] |= (1 << 0);
+        latched_ = inputs_;
+
+        regs_[0x00] = (inputs_.vin_mv > 0 ? 0x80 : 0) | (inputs_.vbus_present ? 0x20 : 0) | (inputs_.bat_ma > 0 ? 0x04 : 0);
+        regs_[0x01] = (inputs_.charging ? 0x40 : 0) | (inputs_.battery_present ? 0x20 : 0);
+        last_sync_us_ = now;
+    }
+
+    void AXP192Model::press_button(bool long_press)
+    {
+        sync();
+        regs_[0x46] |= long_press ? (1 << 0) : (1 << 1);
+    }
+
+    bool AXP192Model::irq_asserted()
+    {
+        sync();
+        for (uint8_t i = 0; i < 4; i++)
+        {
+            if (regs_[0x44 + i] & regs_[0x40 + i])
+                return true;
+        }
+        return regs_[0x4D] & regs_[0x4A];
+    }
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include <cstdint>
+#include "esphome/components/i2c/i2c.h"
+
+namespace sim
+{
+    // Bus cost of everything the component sent since the last reset()
+    struct BusStats
+    {
+        uint32_t transactions{0};
+        uint32_t failures{0};
+        uint32_t reads{0};
+        uint32_t writes{0};
+        // On the wire, address bytes included
+        uint32_t bytes{0};
+        uint64_t bus_us{0};
+        uint32_t register_writes[256]{};
+
+        void reset() { *this = BusStats(); }
+    };
+
+    // Physical quantities the ADCs convert, changed by tests through AXP192Model::inputs()
+    struct AXP192Inputs
+    {
+        float bat_mv{3900.0f};
+        // Positive while charging
+        float bat_ma{-80.0f};
+        float vbus_mv{0.0f};
+        float vbus_ma{0.0f};
+        float vin_mv{0.0f};
+        float vin_ma{0.0f};
+        float temp_c{35.0f};
+        float aps_mv{3900.0f};
+        float ts_mv{0.0f};
+        bool vbus_present{false};
+        bool charging{false};
+        bool battery_present{true};
+    };
+
+    // Register-level AXP192 on the other end of the bus. ADC results, coulomb counters and IRQ status
+    // follow the datasheet behaviour the component relies on, timed against sim::world_us:
+    // - an enabled ADC channel converts once per sample period (0x84 bits 7:6, 25Hz << n), the first result
+    //   one full period after it was enabled; a disabled channel keeps its last result
+    // - the coulomb counter (0xB0..0xB7) integrates the battery current while 0xB8 bit 7 runs it, bit 6
+    //   doesn't pause it and the battery current ADC is enabled, at |I| * rate / 32768 counts per second
+    // - IRQ status (0x44..0x47) latches on VBUS, charger, button and APS low voltage edges; it and the timer
+    //   status 0x4D are write 1 to clear
+    class AXP192Model : public esphome::i2c::I2CTarget
+    {
+    public:
+        // 400kHz, 9 clocks per byte; fixed cost per transaction for start/stop and the driver
+        static constexpr float BIT_US = 2.5f;
+        static constexpr uint32_t TRANSACTION_OVERHEAD_US = 50;
+
+        AXP192Model() { power_on(); }
+
+        // Battery inserted: every register back to its default, counters cleared
+        void power_on();
+        // Power key after PowerOff(): registers back to default, the data buffer 0x06..0x0B kept
+        void power_key();
+
+        esphome::i2c::ErrorCode read_register(uint8_t a_register, uint8_t *data, size_t len) override;
+        esphome::i2c::ErrorCode write(const uint8_t *data, size_t len) override;
+
+        // Inputs as of now; changes made through the reference apply from this point in time
+        AXP192Inputs &inputs()
+        {
+            sync();
+            return inputs_;
+        }
+        void press_button(bool long_press);
+        // IRQ output, open drain and active low: any status bit that is also enabled
+        bool irq_asserted();
+
+        // Bring conversions, counters and IRQ status up to sim::world_us
+        void sync();
+
+        uint8_t reg(uint8_t addr)
+        {
+            sync();
+            return regs_[addr];
+        }
+        void set_reg(uint8_t addr, uint8_t value)
+        {
+            sync();
+            regs_[addr] = value;
+        }
+        bool powered_off() const { return (regs_[0x32] & 0x80) != 0; }
+        uint32_t adc_rate_hz() const { return 25u << (regs_[0x84] >> 6); }
+        uint16_t adc_enables() const { return (regs_[0x82] << 8) | regs_[0x83]; }
+        // Coulomb counts, fractional
+        double coulomb_in() const { return coulomb_in_; }
+        double coulomb_out() const { return coulomb_out_; }
+
+        BusStats stats;
+        // Failure injection: NACK this many transactions, NACK every write of more than one register, NACK every
+        // read starting at fail_reads_at
+        uint32_t fail_next{0};
+        bool reject_multi_write{false};
+        int fail_reads_at{-1};
+        // Extra delay before a newly enabled channel's first result, on top of one sample period; the
+        // datasheet does not say where in the conversion cycle an enable lands, so tests sweep it
+        uint64_t first_conversion_delay_us{0};
+
+    protected:
+        void account(size_t bytes, bool failed);
+        void write_register(uint8_t addr, uint8_t value);
+        void convert(uint8_t channel);
+        void set_enables(uint16_t enables);
+
+        uint8_t regs_[256];
+        AXP192Inputs inputs_;
+        AXP192Inputs latched_;
+        uint64_t last_sync_us_{0};
+        // When each of the 16 enable bits of 0x82/0x83 (bit 15 = 0x82 bit 7) last came on
+        uint64_t enabled_at_[16]{};
+        double coulomb_in_{0.0};
+        double coulomb_out_{0.0};
+    };
+}
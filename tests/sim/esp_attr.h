@@ -0,0 +1,7 @@
+#pragma once
+// RTC memory is ordinary static storage on the host, see esphome::axp192::lose_rtc_memory() in axp192_rig.h
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
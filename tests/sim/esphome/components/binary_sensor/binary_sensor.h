@@ -0,0 +1,22 @@
+#pragma once
+#include <vector>
+#include "esphome/core/component.h"
+
+namespace esphome
+{
+    namespace binary_sensor
+    {
+        class BinarySensor
+        {
+        public:
+            void publish_state(bool state)
+            {
+                this->state = state;
+                history.push_back(state);
+            }
+
+            bool state{false};
+            std::vector<bool> history;
+        };
+    }
+}
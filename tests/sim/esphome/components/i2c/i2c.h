@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome
+{
+    namespace i2c
+    {
+        enum ErrorCode
+        {
+            NO_ERROR = 0,
+            ERROR_OK = 0,
+            ERROR_INVALID_ARGUMENT,
+            ERROR_NOT_ACKNOWLEDGED,
+            ERROR_TIMEOUT,
+            ERROR_NOT_INITIALIZED,
+            ERROR_TOO_LARGE,
+            ERROR_UNKNOWN,
+            ERROR_CRC,
+        };
+
+        // What sits on the other end of the bus, see sim::AXP192Model
+        class I2CTarget
+        {
+        public:
+            virtual ~I2CTarget() {}
+            virtual ErrorCode read_register(uint8_t a_register, uint8_t *data, size_t len) = 0;
+            virtual ErrorCode write(const uint8_t *data, size_t len) = 0;
+        };
+
+        class I2CDevice
+        {
+        public:
+            void set_i2c_address(uint8_t address) { address_ = address; }
+            void set_i2c_target(I2CTarget *target) { target_ = target; }
+
+            ErrorCode write(const uint8_t *data, size_t len, bool stop = true)
+            {
+                return target_ != nullptr ? target_->write(data, len) : ERROR_NOT_INITIALIZED;
+            }
+            ErrorCode read_register(uint8_t a_register, uint8_t *data, size_t len, bool stop = true)
+            {
+                return target_ != nullptr ? target_->read_register(a_register, data, len) : ERROR_NOT_INITIALIZED;
+            }
+            bool read_byte(uint8_t a_register, uint8_t *data, bool stop = true)
+            {
+                return read_register(a_register, data, 1, stop) == ERROR_OK;
+            }
+            bool write_byte(uint8_t a_register, uint8_t data, bool stop = true)
+            {
+                uint8_t buf[2] = {a_register, data};
+                return write(buf, 2, stop) == ERROR_OK;
+            }
+
+        protected:
+            uint8_t address_{0x34};
+            I2CTarget *target_{nullptr};
+        };
+    }
+}
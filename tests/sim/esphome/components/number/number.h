@@ -0,0 +1,22 @@
+#pragma once
+#include <cmath>
+#include "esphome/core/component.h"
+
+namespace esphome
+{
+    namespace number
+    {
+        class Number
+        {
+        public:
+            virtual ~Number() {}
+            void publish_state(float state) { this->state = state; }
+            void make_call_set_value(float value) { control(value); }
+
+            float state{NAN};
+
+        protected:
+            virtual void control(float value) = 0;
+        };
+    }
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include "esphome/core/component.h"
+
+namespace esphome
+{
+    namespace output
+    {
+        class FloatOutput
+        {
+        public:
+            virtual ~FloatOutput() {}
+            void set_level(float state) { write_state(state); }
+
+        protected:
+            virtual void write_state(float state) = 0;
+        };
+    }
+}
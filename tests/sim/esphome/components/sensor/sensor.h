@@ -0,0 +1,22 @@
+#pragma once
+#include <cmath>
+#include "esphome/core/component.h"
+
+namespace esphome
+{
+    namespace sensor
+    {
+        class Sensor
+        {
+        public:
+            void publish_state(float state)
+            {
+                this->state = state;
+                publishes++;
+            }
+
+            float state{NAN};
+            unsigned publishes{0};
+        };
+    }
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "esphome/core/component.h"
+
+namespace esphome
+{
+    namespace switch_
+    {
+        class Switch
+        {
+        public:
+            virtual ~Switch() {}
+            void publish_state(bool state) { this->state = state; }
+            void turn_on() { write_state(true); }
+            void turn_off() { write_state(false); }
+
+            bool state{false};
+
+        protected:
+            virtual void write_state(bool state) = 0;
+        };
+    }
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <string>
+
+namespace esphome
+{
+    class Application
+    {
+    public:
+        void run_safe_shutdown_hooks() { safe_shutdown_hooks_run++; }
+        const std::string &get_name() const { return name_; }
+
+        unsigned safe_shutdown_hooks_run{0};
+
+    protected:
+        std::string name_{"sim"};
+    };
+
+    extern Application App;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <functional>
+#include <vector>
+#include "esphome/core/helpers.h"
+
+namespace esphome
+{
+    template <typename... Ts>
+    class Trigger
+    {
+    public:
+        void trigger(Ts... x) { count++; }
+        unsigned count{0};
+    };
+
+    template <typename... Ts>
+    class Action
+    {
+    public:
+        virtual ~Action() {}
+        virtual void play(Ts... x) = 0;
+    };
+
+    template <typename T, typename... X>
+    class TemplatableValue
+    {
+    public:
+        TemplatableValue() {}
+        TemplatableValue(T value) : value_(value), has_value_(true) {}
+        bool has_value() const { return has_value_; }
+        T value(X... x) { return value_; }
+
+    protected:
+        T value_{};
+        bool has_value_{false};
+    };
+}
+
+#define TEMPLATABLE_VALUE(type, name)                   \
+protected:                                              \
+    TemplatableValue<type, Ts...> name##_{};            \
+                                                        \
+public:                                                 \
+    template <typename V>                               \
+    void set_##name(V name) { this->name##_ = name; }
@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+
+namespace esphome
+{
+    namespace setup_priority
+    {
+        extern const float BUS;
+        extern const float IO;
+        extern const float HARDWARE;
+        extern const float DATA;
+        extern const float PROCESSOR;
+        extern const float AFTER_WIFI;
+        extern const float LATE;
+    }
+
+    // set_interval()/set_timeout() really run, from run_scheduler() against the simulated clock
+    class Component
+    {
+    public:
+        virtual ~Component() {}
+        virtual void setup() {}
+        virtual void loop() {}
+        virtual void dump_config() {}
+        virtual float get_setup_priority() const { return 0.0f; }
+        virtual bool can_proceed() { return true; }
+        virtual void on_shutdown() {}
+        virtual void on_safe_shutdown() {}
+        void mark_failed() { failed_ = true; }
+        bool is_failed() const { return failed_; }
+        void status_set_warning() { warning_ = true; }
+        void status_clear_warning() { warning_ = false; }
+        bool status_has_warning() const { return warning_; }
+
+        // Run every timer that is due, in order of its due time
+        void run_scheduler();
+        bool has_timer(const std::string &name) const;
+
+    protected:
+        void set_interval(const std::string &name, uint32_t interval, std::function<void()> &&f);
+        void set_interval(uint32_t interval, std::function<void()> &&f) { set_interval("", interval, std::move(f)); }
+        bool cancel_interval(const std::string &name) { return cancel_timer(name); }
+        void set_timeout(const std::string &name, uint32_t timeout, std::function<void()> &&f);
+        void set_timeout(uint32_t timeout, std::function<void()> &&f) { set_timeout("", timeout, std::move(f)); }
+        bool cancel_timeout(const std::string &name) { return cancel_timer(name); }
+        void defer(std::function<void()> &&f) { set_timeout("", 0, std::move(f)); }
+        void defer(const std::string &name, std::function<void()> &&f) { set_timeout(name, 0, std::move(f)); }
+
+    private:
+        struct Timer
+        {
+            std::string name;
+            uint32_t interval;
+            uint32_t next;
+            bool repeat;
+            std::function<void()> f;
+        };
+        bool cancel_timer(const std::string &name);
+        std::vector<Timer> timers_;
+        bool failed_{false};
+        bool warning_{false};
+    };
+
+    class PollingComponent : public Component
+    {
+    public:
+        PollingComponent() {}
+        explicit PollingComponent(uint32_t update_interval) : update_interval_(update_interval) {}
+        virtual void update() = 0;
+        uint32_t get_update_interval() const { return update_interval_; }
+        void set_update_interval(uint32_t update_interval) { update_interval_ = update_interval; }
+
+    protected:
+        uint32_t update_interval_{60000};
+    };
+}
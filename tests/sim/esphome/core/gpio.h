@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+
+namespace esphome
+{
+    namespace gpio
+    {
+        enum InterruptType
+        {
+            INTERRUPT_RISING_EDGE = 1,
+            INTERRUPT_FALLING_EDGE = 2,
+            INTERRUPT_ANY_EDGE = 3,
+        };
+    }
+
+    class GPIOPin
+    {
+    public:
+        virtual ~GPIOPin() {}
+        virtual void setup() = 0;
+        virtual bool digital_read() = 0;
+    };
+
+    // The ISR is kept so a test can fire the edge with trigger_interrupt()
+    class InternalGPIOPin : public GPIOPin
+    {
+    public:
+        explicit InternalGPIOPin(uint8_t pin = 0) : pin_(pin) {}
+        void setup() override { setup_ = true; }
+        bool digital_read() override { return level_; }
+        uint8_t get_pin() const { return pin_; }
+        bool is_inverted() const { return false; }
+        template <typename T>
+        void attach_interrupt(void (*func)(T *), T *arg, gpio::InterruptType type) const
+        {
+            isr_ = [func, arg]() { func(arg); };
+        }
+
+        void set_level(bool level) { level_ = level; }
+        bool trigger_interrupt() const
+        {
+            if (!isr_)
+                return false;
+            isr_();
+            return true;
+        }
+
+    protected:
+        uint8_t pin_;
+        bool setup_{false};
+        bool level_{true};
+        mutable std::function<void()> isr_;
+    };
+}
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
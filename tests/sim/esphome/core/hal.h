@@ -0,0 +1,11 @@
+#pragma once
+#include <cstdint>
+
+namespace esphome
+{
+    // Simulated clock, see sim::advance_us()
+    uint32_t millis();
+    uint32_t micros();
+    void delay(uint32_t ms);
+    void delayMicroseconds(uint32_t us);
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace esphome
+{
+    template <typename... Ts>
+    class CallbackManager;
+
+    template <typename... Ts>
+    class CallbackManager<void(Ts...)>
+    {
+    public:
+        void add(std::function<void(Ts...)> &&callback) { callbacks_.push_back(std::move(callback)); }
+        void call(Ts... args)
+        {
+            for (auto &callback : callbacks_)
+                callback(args...);
+        }
+
+    protected:
+        std::vector<std::function<void(Ts...)>> callbacks_;
+    };
+
+    template <typename T>
+    T clamp(T value, T lo, T hi)
+    {
+        return value < lo ? lo : (value > hi ? hi : value);
+    }
+
+    uint32_t fnv1_hash(const std::string &str);
+
+    template <typename T>
+    class Parented
+    {
+    public:
+        Parented() {}
+        Parented(T *parent) : parent_(parent) {}
+        T *get_parent() const { return parent_; }
+        void set_parent(T *parent) { parent_ = parent; }
+
+    protected:
+        T *parent_{nullptr};
+    };
+}
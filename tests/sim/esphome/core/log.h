@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdio>
+
+namespace sim
+{
+    // Printed only when SIM_LOG is set in the environment
+    void log(char level, const char *tag, const char *format, ...) __attribute__((format(printf, 3, 4)));
+}
+
+// Like a firmware built at the default DEBUG level: VERBOSE is compiled out, arguments and all
+#define ESP_LOGE(tag, ...) sim::log('E', tag, __VA_ARGS__)
+#define ESP_LOGW(tag, ...) sim::log('W', tag, __VA_ARGS__)
+#define ESP_LOGI(tag, ...) sim::log('I', tag, __VA_ARGS__)
+#define ESP_LOGD(tag, ...) sim::log('D', tag, __VA_ARGS__)
+#define ESP_LOGV(tag, ...) \
+    do                     \
+    {                      \
+    } while (0)
+#define ESP_LOGCONFIG(tag, ...) sim::log('C', tag, __VA_ARGS__)
+#define LOG_SENSOR(prefix, name, sensor) (void) (sensor)
+#define LOG_BINARY_SENSOR(prefix, name, sensor) (void) (sensor)
+#define LOG_I2C_DEVICE(device) (void) (device)
+#define LOG_PIN(prefix, pin) (void) (pin)
+#define LOG_UPDATE_INTERVAL(component) (void) (component)
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <vector>
+
+namespace sim
+{
+    // Flash, shared by every preference object; survives simulated reboots and power loss
+    extern std::map<uint32_t, std::vector<uint8_t>> flash;
+    extern uint32_t flash_writes;
+    extern bool flash_fail;
+}
+
+namespace esphome
+{
+    class ESPPreferenceObject
+    {
+    public:
+        ESPPreferenceObject() {}
+        explicit ESPPreferenceObject(uint32_t key) : key_(key), valid_(true) {}
+
+        template <typename T>
+        bool save(const T *src)
+        {
+            if (!valid_ || sim::flash_fail)
+                return false;
+            const uint8_t *bytes = reinterpret_cast<const uint8_t *>(src);
+            sim::flash[key_].assign(bytes, bytes + sizeof(T));
+            sim::flash_writes++;
+            return true;
+        }
+        template <typename T>
+        bool load(T *dest)
+        {
+            auto it = sim::flash.find(key_);
+            if (!valid_ || it == sim::flash.end() || it->second.size() != sizeof(T))
+                return false;
+            memcpy(dest, it->second.data(), sizeof(T));
+            return true;
+        }
+
+    protected:
+        uint32_t key_{0};
+        bool valid_{false};
+    };
+
+    class ESPPreferences
+    {
+    public:
+        template <typename T>
+        ESPPreferenceObject make_preference(uint32_t type, bool in_flash)
+        {
+            return ESPPreferenceObject(type);
+        }
+        template <typename T>
+        ESPPreferenceObject make_preference(uint32_t type)
+        {
+            return ESPPreferenceObject(type);
+        }
+        bool sync() { return true; }
+    };
+
+    extern ESPPreferences *global_preferences;
+}
@@ -0,0 +1,194 @@
+#include "sim.h"
+#include "esphome/core/application.h"
+#include "esphome/core/component.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "esphome/core/preferences.h"
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+namespace sim
+{
+    uint64_t world_us = 0;
+    uint64_t boot_us = 0;
+    esp_reset_reason_t reset_reason = ESP_RST_POWERON;
+    esp_sleep_wakeup_cause_t wakeup_cause = ESP_SLEEP_WAKEUP_UNDEFINED;
+    WakeSources wake_sources;
+    unsigned light_sleeps = 0;
+    uint64_t light_sleep_default_us = 1000000;
+    std::vector<std::string> log_lines;
+    std::map<uint32_t, std::vector<uint8_t>> flash;
+    uint32_t flash_writes = 0;
+    bool flash_fail = false;
+
+    static const size_t LOG_LINES_MAX = 4096;
+
+    void advance_us(uint64_t us) { world_us += us; }
+
+    void reboot(esp_reset_reason_t reason, esp_sleep_wakeup_cause_t cause)
+    {
+        boot_us = world_us;
+        reset_reason = reason;
+        wakeup_cause = cause;
+    }
+
+    void log(char level, const char *tag, const char *format, ...)
+    {
+        char line[512];
+        int prefix = snprintf(line, sizeof(line), "[%c][%s] ", level, tag);
+        va_list args;
+        va_start(args, format);
+        vsnprintf(line + prefix, sizeof(line) - prefix, format, args);
+        va_end(args);
+        if (log_lines.size() >= LOG_LINES_MAX)
+            log_lines.erase(log_lines.begin());
+        log_lines.emplace_back(line);
+        if (getenv("SIM_LOG") != nullptr)
+            fprintf(stderr, "%10.3f %s\n", (world_us - boot_us) / 1000.0, line);
+    }
+
+    void log_clear() { log_lines.clear(); }
+
+    bool log_contains(const std::string &needle) { return log_count(needle) > 0; }
+
+    unsigned log_count(const std::string &needle)
+    {
+        return std::count_if(log_lines.begin(), log_lines.end(),
+                             [&needle](const std::string &line) { return line.find(needle) != std::string::npos; });
+    }
+}
+
+namespace esphome
+{
+    namespace setup_priority
+    {
+        const float BUS = 1000.0f;
+        const float IO = 900.0f;
+        const float HARDWARE = 800.0f;
+        const float DATA = 600.0f;
+        const float PROCESSOR = 400.0f;
+        const float AFTER_WIFI = 200.0f;
+        const float LATE = -100.0f;
+    }
+
+    Application App;
+    static ESPPreferences preferences;
+    ESPPreferences *global_preferences = &preferences;
+
+    uint32_t millis() { return (sim::world_us - sim::boot_us) / 1000; }
+    uint32_t micros() { return sim::world_us - sim::boot_us; }
+    void delay(uint32_t ms) { sim::advance_us(ms * 1000ULL); }
+    void delayMicroseconds(uint32_t us) { sim::advance_us(us); }
+
+    uint32_t fnv1_hash(const std::string &str)
+    {
+        uint32_t hash = 2166136261UL;
+        for (char c : str)
+        {
+            hash *= 16777619UL;
+            hash ^= (uint8_t) c;
+        }
+        return hash;
+    }
+
+    void Component::set_interval(const std::string &name, uint32_t interval, std::function<void()> &&f)
+    {
+        if (!name.empty())
+            cancel_timer(name);
+        timers_.push_back({name, interval, millis() + interval, true, std::move(f)});
+    }
+
+    void Component::set_timeout(const std::string &name, uint32_t timeout, std::function<void()> &&f)
+    {
+        if (!name.empty())
+            cancel_timer(name);
+        timers_.push_back({name, timeout, millis() + timeout, false, std::move(f)});
+    }
+
+    bool Component::cancel_timer(const std::string &name)
+    {
+        auto it = std::remove_if(timers_.begin(), timers_.end(), [&name](const Timer &t) { return t.name == name; });
+        bool found = it != timers_.end();
+        timers_.erase(it, timers_.end());
+        return found;
+    }
+
+    bool Component::has_timer(const std::string &name) const
+    {
+        return std::any_of(timers_.begin(), timers_.end(), [&name](const Timer &t) { return t.name == name; });
+    }
+
+    void Component::run_scheduler()
+    {
+        for (;;)
+        {
+            uint32_t now = millis();
+            auto due = timers_.end();
+            for (auto it = timers_.begin(); it != timers_.end(); ++it)
+            {
+                if ((int32_t) (now - it->next) >= 0 && (due == timers_.end() || (int32_t) (it->next - due->next) < 0))
+                    due = it;
+            }
+            if (due == timers_.end())
+                return;
+            // The callback may add or cancel timers, run a copy
+            std::function<void()> f = due->f;
+            if (due->repeat)
+                due->next = now + due->interval;
+            else
+                timers_.erase(due);
+            f();
+        }
+    }
+}
+
+esp_reset_reason_t esp_reset_reason(void) { return sim::reset_reason; }
+
+void esp_restart(void) { throw sim::Restart{}; }
+
+esp_err_t esp_sleep_enable_ext0_wakeup(gpio_num_t gpio_num, int level)
+{
+    sim::wake_sources.ext0_pin = gpio_num;
+    sim::wake_sources.ext0_level = level;
+    return 0;
+}
+
+esp_err_t esp_sleep_enable_ext1_wakeup(uint64_t mask, esp_sleep_ext1_wakeup_mode_t mode)
+{
+    sim::wake_sources.ext1_mask = mask;
+    sim::wake_sources.ext1_mode = mode;
+    return 0;
+}
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us)
+{
+    sim::wake_sources.timer_us = time_in_us;
+    return 0;
+}
+
+esp_err_t esp_sleep_disable_wakeup_source(esp_sleep_source_t source)
+{
+    if (source == ESP_SLEEP_WAKEUP_ALL)
+        sim::wake_sources = sim::WakeSources();
+    return 0;
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause(void) { return sim::wakeup_cause; }
+
+void esp_deep_sleep_start(void) { throw sim::DeepSleep{sim::wake_sources.timer_us}; }
+
+void esp_deep_sleep(uint64_t time_in_us)
+{
+    esp_sleep_enable_timer_wakeup(time_in_us);
+    esp_deep_sleep_start();
+}
+
+esp_err_t esp_light_sleep_start(void)
+{
+    sim::light_sleeps++;
+    sim::advance_us(sim::wake_sources.timer_us > 0 ? sim::wake_sources.timer_us : sim::light_sleep_default_us);
+    return 0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "esp_sleep.h"
+#include "esp_system.h"
+
+// Host stand-in for the ESP32 the component normally runs on: a clock, reset/sleep state and a log
+namespace sim
+{
+    // Time since the simulation started; the PMIC model runs on this clock and keeps running through ESP reboots
+    extern uint64_t world_us;
+    // world_us at the last ESP boot, millis() and micros() count from here
+    extern uint64_t boot_us;
+    void advance_us(uint64_t us);
+    inline void advance_ms(uint64_t ms) { advance_us(ms * 1000); }
+
+    // The ESP starts over: the clock restarts, the reset reason is what the next setup() sees
+    void reboot(esp_reset_reason_t reason, esp_sleep_wakeup_cause_t wakeup_cause = ESP_SLEEP_WAKEUP_UNDEFINED);
+    extern esp_reset_reason_t reset_reason;
+    extern esp_sleep_wakeup_cause_t wakeup_cause;
+
+    // Wake sources armed before the last sleep
+    struct WakeSources
+    {
+        int ext0_pin{-1};
+        int ext0_level{-1};
+        uint64_t ext1_mask{0};
+        int ext1_mode{-1};
+        uint64_t timer_us{0};
+    };
+    extern WakeSources wake_sources;
+
+    // Thrown by esp_deep_sleep_start(): execution never returns from deep sleep
+    struct DeepSleep
+    {
+        uint64_t timer_us;
+    };
+    // Thrown by esp_restart()
+    struct Restart
+    {
+    };
+    // Light sleeps taken so far; each advances the clock by the armed timer, or light_sleep_default_us without one
+    extern unsigned light_sleeps;
+    extern uint64_t light_sleep_default_us;
+
+    // Log lines printed since the last log_clear(), echoed to stderr when SIM_LOG is set
+    extern std::vector<std::string> log_lines;
+    void log_clear();
+    bool log_contains(const std::string &needle);
+    unsigned log_count(const std::string &needle);
+}
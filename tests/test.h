@@ -0,0 +1,82 @@
+#pragma once
+// Just enough of a test framework: TEST() registers, CHECK*() records failures and carries on
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace test
+{
+    struct Case
+    {
+        const char *name;
+        void (*run)();
+    };
+
+    inline std::vector<Case> &cases()
+    {
+        static std::vector<Case> all;
+        return all;
+    }
+
+    struct Register
+    {
+        Register(const char *name, void (*run)()) { cases().push_back({name, run}); }
+    };
+
+    inline unsigned &failures()
+    {
+        static unsigned count = 0;
+        return count;
+    }
+
+    inline bool check(bool ok, const char *expr, const char *file, int line, const char *detail = "")
+    {
+        if (!ok)
+        {
+            failures()++;
+            fprintf(stderr, "%s:%d: CHECK(%s) failed%s\n", file, line, expr, detail);
+        }
+        return ok;
+    }
+
+    inline bool check_near(double a, double b, double tolerance, const char *expr, const char *file, int line)
+    {
+        char detail[96];
+        snprintf(detail, sizeof(detail), ": %g vs %g (tolerance %g)", a, b, tolerance);
+        return check(fabs(a - b) <= tolerance, expr, file, line, detail);
+    }
+
+    inline bool check_eq(long long a, long long b, const char *expr, const char *file, int line)
+    {
+        char detail[96];
+        snprintf(detail, sizeof(detail), ": %lld vs %lld", a, b);
+        return check(a == b, expr, file, line, detail);
+    }
+
+    // Runs every test, or those whose name contains argv[1]
+    inline int run(int argc, char **argv, const char *suite)
+    {
+        unsigned ran = 0;
+        for (const Case &c : cases())
+        {
+            if (argc > 1 && strstr(c.name, argv[1]) == nullptr)
+                continue;
+            unsigned before = failures();
+            c.run();
+            ran++;
+            if (failures() != before)
+                fprintf(stderr, "FAIL %s\n", c.name);
+        }
+        printf("%s: %u tests, %u failed checks\n", suite, ran, failures());
+        return failures() == 0 ? 0 : 1;
+    }
+}
+
+#define TEST(name)                                            \
+    static void test_##name();                                \
+    static test::Register register_##name(#name, test_##name); \
+    static void test_##name()
+#define CHECK(cond) test::check((cond), #cond, __FILE__, __LINE__)
+#define CHECK_EQ(a, b) test::check_eq((a), (b), #a " == " #b, __FILE__, __LINE__)
+#define CHECK_NEAR(a, b, tolerance) test::check_near((a), (b), (tolerance), #a " ~ " #b, __FILE__, __LINE__)
@@ -0,0 +1,1190 @@
+// Behaviour of the component against the simulated PMIC, built once per AXP192Model
+#include "axp192_rig.h"
+#include "test.h"
+#include <fstream>
+#include <sstream>
+
+using namespace esphome;
+using namespace esphome::axp192;
+using sim::Rig;
+
+static void all_channels(Rig &rig, TestAXP192 &axp)
+{
+    axp.set_batteryvoltage_sensor(rig.sensor("battery_voltage"));
+    axp.set_batterycurrent_sensor(rig.sensor("battery_current"));
+    axp.set_vbusvoltage_sensor(rig.sensor("vbus_voltage"));
+    axp.set_vbuscurrent_sensor(rig.sensor("vbus_current"));
+    axp.set_vincurrent_sensor(rig.sensor("vin_current"));
+    axp.set_temperature_sensor(rig.sensor("temperature"));
+}
+
+static void usb_powered(Rig &rig)
+{
+    sim::AXP192Inputs &in = rig.pmic.inputs();
+    in.vbus_present = true;
+    in.vbus_mv = 5050.0f;
+    in.vbus_ma = 240.0f;
+    in.charging = true;
+    in.bat_ma = 150.0f;
+}
+
+//---------- ADC decoding ----------
+TEST(decodes_every_channel_within_one_lsb)
+{
+    Rig rig(all_channels);
+    sim::AXP192Inputs &in = rig.pmic.inputs();
+    in.bat_mv = 4012.0f;
+    in.bat_ma = -123.5f;
+    in.vbus_present = true;
+    in.vbus_mv = 5012.0f;
+    in.vbus_ma = 321.0f;
+    in.vin_ma = 42.0f;
+    in.temp_c = 41.3f;
+    rig.boot();
+    sim::advance_ms(100);
+    rig.poll();
+
+    CHECK_NEAR(rig.state("battery_voltage"), 4.012, 0.0011);
+    // Decoded to whole mA
+    CHECK_NEAR(rig.state("battery_current"), -0.1235, 0.001);
+    CHECK_NEAR(rig.state("vbus_voltage"), 5.012, 0.0017);
+    CHECK_NEAR(rig.state("vbus_current"), 0.321, 0.000375);
+    CHECK_NEAR(rig.state("vin_current"), 0.042, 0.000625);
+    CHECK_NEAR(rig.state("temperature"), 41.3, 0.1);
+}
+
+TEST(battery_level_from_voltage)
+{
+    Rig rig([](Rig &rig, TestAXP192 &axp) { axp.set_batterylevel_sensor(rig.sensor("battery_level")); });
+    rig.pmic.inputs().bat_mv = 3600.0f;
+    rig.boot();
+    rig.poll();
+    CHECK_NEAR(rig.state("battery_level"), 50.0, 0.2);
+}
+
+TEST(unused_low_bits_do_not_leak_into_the_result)
+{
+    Rig rig([](Rig &rig, TestAXP192 &axp) {
+        axp.set_batteryvoltage_sensor(rig.sensor("battery_voltage"));
+        axp.set_batterycurrent_sensor(rig.sensor("battery_current"));
+    });
+    sim::AXP192Inputs &in = rig.pmic.inputs();
+    in.bat_mv = 3800.0f;
+    in.bat_ma = 200.0f;
+    TestAXP192 &axp = rig.boot();
+    sim::advance_ms(100);
+    float voltage = axp.GetBatVoltage();
+    float charge = axp.GetBatChargeCurrent();
+    CHECK_NEAR(voltage, 3.8, 0.0011);
+    CHECK_NEAR(charge, 200.0, 0.5);
+
+    // Only 4 (12 bit) and 5 (13 bit) low bits belong to the result
+    rig.pmic.set_reg(0x79, rig.pmic.reg(0x79) | 0xF0);
+    rig.pmic.set_reg(0x7B, rig.pmic.reg(0x7B) | 0xE0);
+    CHECK_EQ(axp.GetBatVoltage(), voltage);
+    CHECK_EQ(axp.GetBatChargeCurrent(), charge);
+}
+
+//---------- Bus traffic ----------
+TEST(update_is_one_burst_read)
+{
+    Rig rig([](Rig &rig, TestAXP192 &axp) {
+        all_channels(rig, axp);
+        axp.set_batterylevel_sensor(rig.sensor("battery_level"));
+    });
+    rig.boot();
+    rig.poll();
+    rig.pmic.stats.reset();
+    rig.poll();
+    CHECK_EQ(rig.pmic.stats.reads, 1);
+    CHECK_EQ(rig.pmic.stats.writes, 0);
+    CHECK_EQ(rig.sensor("battery_level")->publishes, 2);
+    CHECK(rig.axp->adc_block_first_ > rig.axp->adc_block_last_);
+}
+
+TEST(failed_reads_are_retried)
+{
+    Rig rig(all_channels);
+    rig.boot();
+    rig.pmic.fail_next = AXP192_I2C_RETRIES;
+    rig.poll();
+    CHECK(!std::isnan(rig.state("battery_voltage")));
+    CHECK_EQ(rig.axp->get_i2c_stats().retries, AXP192_I2C_RETRIES);
+    CHECK_EQ(rig.axp->get_i2c_stats().failures, 0);
+}
+
+TEST(failed_read_publishes_nan)
+{
+    Rig rig(all_channels);
+    rig.boot();
+    rig.pmic.fail_next = 100;
+    rig.poll();
+    rig.pmic.fail_next = 0;
+    CHECK(std::isnan(rig.state("battery_voltage")));
+    CHECK(rig.axp->get_i2c_stats().failures > 0);
+    CHECK(rig.axp->status_has_warning());
+}
+
+TEST(battery_state_reads_the_presence_bit)
+{
+    Rig rig;
+    TestAXP192 &axp = rig.boot();
+    CHECK(axp.GetBatState());
+    rig.pmic.inputs().battery_present = false;
+    CHECK(!axp.GetBatState());
+    rig.pmic.inputs().battery_present = true;
+    rig.pmic.fail_reads_at = 0x01;
+    CHECK(!axp.GetBatState());
+}
+
+TEST(cached_registers_cost_nothing_to_rewrite)
+{
+    Rig rig;
+    TestAXP192 &axp = rig.boot();
+    rig.pmic.stats.reset();
+    axp.SetChargeCurrent(CURRENT_100MA);
+    CHECK_EQ(rig.pmic.stats.transactions, 0);
+
+    axp.SetChargeCurrent(CURRENT_450MA);
+    CHECK_EQ(rig.pmic.stats.transactions, 1);
+    CHECK_EQ(rig.pmic.reg(0x33) & 0x0f, CURRENT_450MA);
+
+    // The first change of 0x12 is one write, setting it again is free
+    axp.SetLDO3(false);
+    rig.pmic.stats.reset();
+    axp.SetLDO3(true);
+    CHECK_EQ(rig.pmic.stats.transactions, 1);
+    axp.SetLDO3(true);
+    CHECK_EQ(rig.pmic.stats.transactions, 1);
+    CHECK(rig.pmic.reg(0x12) & (1 << 3));
+}
+
+TEST(begin_is_one_multi_write)
+{
+    Rig rig;
+    TestAXP192 &axp = rig.boot();
+    axp.reg_cache_valid_ = 0;
+    rig.pmic.stats.reset();
+    axp.begin();
+    // 0x12 is read back to keep the bits begin() doesn't own, and 0x33 too on models without the battery setup
+    CHECK_EQ(rig.pmic.stats.writes, 1);
+    CHECK_EQ(rig.pmic.stats.reads, ModelTraits::BATTERY_SETUP ? 1 : 2);
+    CHECK_EQ(rig.pmic.reg(0x39), 0xfc);
+}
+
+TEST(begin_masks_the_otp_irq_enables_without_events)
+{
+    Rig rig;
+    // Timer IRQ enabled, VBUS insert and the timer latched before boot
+    rig.pmic.set_reg(0x4A, 0x80);
+    rig.pmic.set_reg(0x44, 0x08);
+    rig.pmic.set_reg(0x4D, 0x80);
+    rig.boot();
+    for (uint8_t reg : {0x40, 0x41, 0x42, 0x43, 0x44, 0x4A, 0x4D})
+        CHECK_EQ(rig.pmic.reg(reg), 0);
+    CHECK(!rig.pmic.irq_asserted());
+}
+
+TEST(rejected_multi_write_falls_back_to_single_writes)
+{
+    Rig rig;
+    rig.pmic.reject_multi_write = true;
+    rig.boot();
+    CHECK_EQ(rig.pmic.reg(0x39), 0xfc);
+    CHECK_EQ(rig.pmic.reg(0x84) & 0x3f, 0x32);
+    if (ModelTraits::BATTERY_SETUP)
+        CHECK_EQ(rig.pmic.reg(0x36), 0x0C);
+    CHECK(rig.pmic.stats.writes > 1);
+}
+
+TEST(sleep_entry_is_one_multi_write)
+{
+    Rig rig;
+    TestAXP192 &axp = rig.boot();
+    rig.pmic.stats.reset();
+    axp.SetSleep();
+    CHECK_EQ(rig.pmic.stats.writes, 1);
+    CHECK_EQ(rig.pmic.reg(0x82), 0x00);
+    CHECK_EQ(rig.pmic.reg(0x12) & 0x5E, 0x00);
+}
+
+TEST(resync_picks_up_foreign_writes)
+{
+    Rig rig;
+    TestAXP192 &axp = rig.boot();
+    axp.SetLDO3(true);
+    // Another master switches DCDC2 on behind the cache's back
+    rig.pmic.set_reg(0x12, rig.pmic.reg(0x12) | (1 << 4));
+    axp.ResyncRegisters();
+    CHECK(axp.reg_cache_valid_ != 0);
+    axp.SetLDO3(false);
+    CHECK(rig.pmic.reg(0x12) & (1 << 4));
+    CHECK(!(rig.pmic.reg(0x12) & (1 << 3)));
+}
+
+//---------- ADC enables ----------
+TEST(adc_enables_follow_the_configured_sensors)
+{
+    Rig rig([](Rig &rig, TestAXP192 &axp) { axp.set_batterylevel_sensor(rig.sensor("battery_level")); });
+    rig.boot();
+    CHECK_EQ(rig.pmic.adc_enables(), ADC_BAT_VOLTAGE);
+    CHECK_EQ(rig.pmic.adc_rate_hz(), 25);
+
+    Rig all(all_channels);
+    all.boot();
+    CHECK_EQ(all.pmic.adc_enables(), ADC_BAT_VOLTAGE | ADC_BAT_CURRENT | ADC_VBUS_VOLTAGE | ADC_VBUS_CURRENT |
+                                         ADC_VIN_CURRENT | ADC_TEMPERATURE);
+}
+
+TEST(registered_channels_are_enabled_at_runtime)
+{
+    Rig rig;
+    TestAXP192 &axp = rig.boot();
+    rig.pmic.stats.reset();
+    axp.RegisterAdcChannels(ADC_APS_VOLTAGE, ADC_RATE_100HZ);
+    CHECK(rig.pmic.adc_enables() & ADC_APS_VOLTAGE);
+    CHECK_EQ(rig.pmic.adc_rate_hz(), 100);
+    // 0x84 and 0x82; 0x83 is unchanged and skipped by the cache
+    CHECK_EQ(rig.pmic.stats.writes, 2);
+
+    // Switching the ADCs off and on again brings back the registered set
+    axp.SetAdcState(false);
+    CHECK_EQ(rig.pmic.adc_enables(), 0);
+    axp.SetAdcState(true);
+    CHECK(rig.pmic.adc_enables() & ADC_APS_VOLTAGE);
+}
+
+//---------- Acquisition in loop() ----------
+TEST(acquisition_yields_to_the_main_loop)
+{
+    Rig rig([](Rig &rig, TestAXP192 &axp) {
+        all_channels(rig, axp);
+        axp.set_loop_budget(0);
+    });
+    TestAXP192 &axp = rig.boot();
+    axp.update();
+    unsigned loops = 0;
+    while (axp.update_state_ != UPDATE_IDLE && loops < 100)
+    {
+        rig.loop_once();
+        loops++;
+    }
+    // One step per loop() once the budget is spent: read, battery, six channels, IRQ, brightness
+    CHECK(loops >= 9);
+    CHECK(axp.update_state_ == UPDATE_IDLE);
+}
+
+//---------- Fast sampling ----------
+TEST(fast_samples_aggregate_min_max)
+{
+    Rig rig([](Rig &rig, TestAXP192 &axp) {
+        axp.set_batterycurrent_sensor(rig.sensor("battery_current"));
+        axp.set_channel_min_sensor(CHANNEL_BAT_CURRENT, rig.sensor("battery_current_min"));
+        axp.set_channel_max_sensor(CHANNEL_BAT_CURRENT, rig.sensor("battery_current_max"));
+        axp.set_fast_sample_interval(100);
+        axp.set_update_interval(10000);
+    });
+    rig.boot();
+    // One 10s window at -100mA, then a 1s burst of -400mA in the next
+    rig.pmic.inputs().bat_ma = -100.0f;
+    rig.run_for(10000);
+    rig.run_for(4000);
+    rig.pmic.inputs().bat_ma = -400.0f;
+    rig.run_for(1000);
+    rig.pmic.inputs().bat_ma = -100.0f;
+    rig.run_for(5000);
+    CHECK_NEAR(rig.state("battery_current_min"), -0.4, 0.0005);
+    CHECK_NEAR(rig.state("battery_current_max"), -0.1, 0.0005);
+    CHECK_NEAR(rig.state("battery_current"), -0.13, 0.005);
+    // 100ms sampling needs at least 10Hz conversions, 25Hz is the slowest rate anyway
+    CHECK(rig.pmic.adc_rate_hz() >= 10);
+}
+
+//---------- Per-channel intervals ----------
+TEST(channel_interval_publishes_between_updates)
+{
+    Rig rig([](Rig &rig, TestAXP192 &axp) {
+        axp.set_batteryvoltage_sensor(rig.sensor("battery_voltage"));
+        axp.set_batterycurrent_sensor(rig.sensor("battery_current"));
+        axp.set_channel_update_interval(CHANNEL_BAT_CURRENT, 5000);
+    });
+    rig.boot();
+    rig.run_for(60000);
+    CHECK_EQ(rig.sensor("battery_voltage")->publishes, 1);
+    CHECK(rig.sensor("battery_current")->publishes >= 11);
+}
+
+TEST(channel_interval_waits_for_the_update_snapshot)
+{
+    Rig rig([](Rig &rig, TestAXP192 &axp) {
+        axp.set_batteryvoltage_sensor(rig.sensor("battery_voltage"));
+        axp.set_temperature_sensor(rig.sensor("temperature"));
+        axp.set_channel_update_interval(CHANNEL_TEMPERATURE, 1000);
+        axp.set_loop_budget(0);
+    });
+    TestAXP192 &axp = rig.boot();
+    rig.pmic.inputs().bat_mv = 3700.0f;
+    sim::advance_ms(100);
+    axp.update();
+    rig.loop_once();
+    CHECK(axp.update_state_ != UPDATE_IDLE);
+
+    // The temperature falls due and the battery moves on while the update still decodes its snapshot
+    rig.pmic.inputs().bat_mv = 4100.0f;
+    unsigned temperature = rig.sensor("temperature")->publishes;
+    sim::advance_ms(1000);
+    while (axp.update_state_ != UPDATE_IDLE)
+    {
+        CHECK_EQ(rig.sensor("temperature")->publishes, temperature);
+        rig.loop_once();
+    }
+    CHECK_NEAR(rig.state("battery_voltage"), 3.7, 0.0011);
+    rig.loop_once();
+    CHECK_EQ(rig.sensor("temperature")->publishes, temperature + 1);
+}
+
+//---------- Runtime ----------
+TEST(time_to_empty_at_constant_discharge)
+{
+    Rig rig([](Rig &rig, TestAXP192 &axp) {
+        axp.set_battery_capacity(1000.0f);
+        axp.set_time_to_empty_sensor(rig.sensor("time_to_empty"));
+        axp.set_time_to_full_sensor(rig.sensor("time_to_full"));
+    });
+    rig.pmic.inputs().bat_mv = 3870.0f;
+    rig.pmic.inputs().bat_ma = -200.0f;
+    rig.boot();
+    rig.run_for(60 * 60 * 1000);
+    // 600mAh - 200mAh left at 200mA
+    CHECK_NEAR(rig.state("time_to_empty"), 120.0, 3.0);
+    CHECK(std::isnan(rig.state("time_to_full")));
+}
+
+// Replays traces/handheld_discharge.csv (synthetic, see make_handheld_discharge.py) and compares time_to_empty with
+// the time the rest of the trace takes to drain the charge the gauge holds, so only the current average is judged
+struct TraceRow
+{
+    uint32_t time_s;
+    float battery_ma;
+    float battery_mv;
+    bool vbus;
+};
+
+static std::vector<TraceRow> load_trace(const char *name)
+{
+    std::vector<TraceRow> rows;
+    std::ifstream file(std::string(TESTS_DIR "/traces/") + name);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || !isdigit((unsigned char) line[0]))
+            continue;
+        TraceRow row;
+        int vbus;
+        if (sscanf(line.c_str(), "%u,%f,%f,%d", &row.time_s, &row.battery_ma, &row.battery_mv, &vbus) == 4)
+        {
+            row.vbus = vbus != 0;
+            rows.push_back(row);
+        }
+    }
+    return rows;
+}
+
+// Minutes until the battery rows after index drain charge_mah, continuing at the trace's last hour once it runs out
+static double trace_time_to_empty(const std::vector<TraceRow> &rows, size_t index, double charge_mah)
+{
+    double step_s = rows[1].time_s - rows[0].time_s;
+    double seconds = 0.0;
+    for (size_t i = index + 1; i < rows.size(); i++)
+    {
+        if (rows[i].vbus)
+            continue;
+        double drained = -rows[i].battery_ma * step_s / 3600.0;
+        if (drained >= charge_mah)
+            return (seconds + step_s * charge_mah / drained) / 60.0;
+        charge_mah -= drained;
+        seconds += step_s;
+    }
+    size_t hour = (size_t) (3600 / step_s);
+    double sum_ma = 0.0;
+    for (size_t i = rows.size() - hour; i < rows.size(); i++)
+        sum_ma -= rows[i].battery_ma;
+    return (seconds + charge_mah / (sum_ma / hour) * 3600.0) / 60.0;
+}
+
+TEST(time_to_full_keeps_its_average_on_a_failed_status_read)
+{
+    Rig rig([](Rig &rig, TestAXP192 &axp) {
+        axp.set_battery_capacity(1000.0f);
+        axp.set_time_to_full_sensor(rig.sensor("time_to_full"));
+    });
+    usb_powered(rig);
+    rig.pmic.inputs().bat_mv = 3870.0f;
+    rig.boot();
+    rig.run_for(10 * 60 * 1000);
+    float average = rig.axp->runtime_current_ma_;
+    CHECK(average > 100.0f);
+
+    // An unreadable charge status is not an unplugged charger, the average carries on
+    rig.pmic.fail_reads_at = 0x01;
+    rig.poll();
+    CHECK_NEAR(rig.axp->runtime_current_ma_, average, 5.0);
+    CHECK(!std::isnan(rig.state("time_to_full")));
+}
+
+TEST(time_to_empty_follows_a_recorded_trace)
+{
+    std::vector<TraceRow> rows = load_trace("handheld_discharge.csv");
+    CHECK(rows.size() > 360);
+    if (rows.size() <= 360)
+        return;
+    Rig rig([](Rig &rig, TestAXP192 &axp) {
+        axp.set_battery_capacity(1000.0f);
+        axp.set_time_to_empty_sensor(rig.sensor("time_to_empty"));
+        axp.set_time_to_full_sensor(rig.sensor("time_to_full"));
+    });
+    rig.loop_period_us = 100000;
+    auto apply = [&](const TraceRow &row) {
+        sim::AXP192Inputs &in = rig.pmic.inputs();
+        in.bat_ma = row.battery_ma;
+        in.bat_mv = row.battery_mv;
+        in.vbus_present = row.vbus;
+        in.vbus_mv = row.vbus ? 5000.0f : 0.0f;
+        in.vbus_ma = row.vbus ? 450.0f : 0.0f;
+        in.charging = row.vbus && row.battery_ma > 0.0f;
+    };
+    apply(rows[0]);
+    TestAXP192 &axp = rig.boot();
+
+    sensor::Sensor *empty = rig.sensor("time_to_empty");
+    sensor::Sensor *full = rig.sensor("time_to_full");
+    const uint32_t SETTLE_S = 30 * 60;
+    uint32_t step_s = rows[1].time_s - rows[0].time_s;
+    uint32_t transition_s = 0;
+    unsigned seen = 0, compared = 0, wrong_direction = 0, unknown_late = 0;
+    double worst = 0.0, sum = 0.0;
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        // Stop well before the end, the gauge's charge and the trace's disagree by the seed error there
+        if (rows.size() - i < 3600 / step_s)
+            break;
+        if (i > 0 && rows[i].vbus != rows[i - 1].vbus)
+            transition_s = rows[i].time_s;
+        apply(rows[i]);
+        rig.run_for(step_s * 1000);
+        if (empty->publishes == seen)
+            continue;
+        seen = empty->publishes;
+
+        // After a plug or unplug the estimate never points the old way, and is unknown for one update at most
+        bool unknown = std::isnan(empty->state) && std::isnan(full->state);
+        if (rows[i].vbus ? !std::isnan(empty->state) : !std::isnan(full->state))
+            wrong_direction++;
+        if (unknown && rows[i].time_s - transition_s > 2 * 60)
+            unknown_late++;
+        if (rows[i].vbus || rows[i].time_s - transition_s < SETTLE_S)
+            continue;
+        double truth = trace_time_to_empty(rows, i, axp.fuel_charge_mah_);
+        double error = fabs(empty->state - truth) / truth;
+        worst = std::max(worst, error);
+        sum += error;
+        compared++;
+    }
+    if (getenv("SIM_TABLES") != nullptr)
+        printf("%s: time_to_empty against the trace: %u updates, mean error %.1f%%, worst %.1f%%\n", ModelTraits::NAME,
+               compared, 100.0 * sum / compared, 100.0 * worst);
+    CHECK_EQ(wrong_direction, 0);
+    CHECK_EQ(unknown_late, 0);
+    CHECK(compared > 100);
+    // The 10 minute average follows the trace's 10 minute display cycle, 5.5% mean and 15% worst when written
+    CHECK(sum / compared < 0.08);
+    CHECK(worst < 0.20);
+}
+
+//---------- Charge controller ----------
+TEST(charge_controller_raises_within_budget_and_backs_off)
+{
+    Rig rig([](Rig &rig, TestAXP192 &axp) {
+        axp.set_charge_controller(CURRENT_450MA, 0.5f, 4.5f, 70.0f);
+        axp.set_update_interval(15000);
+    });
+    usb_powered(rig);
+    rig.boot();
+    rig.run_for(10 * 60 * 1000);
+    CHECK_EQ(rig.pmic.reg(0x33) & 0x0f, CURRENT_450MA);
+
+    // Supply sags: one step down per update
+    rig.pmic.inputs().vbus_mv = 4400.0f;
+    rig.run_for(31000);
+    CHECK((rig.pmic.reg(0x33) & 0x0f) < CURRENT_450MA);
+    CHECK_EQ(rig.axp->charge_step_, rig.pmic.reg(0x33) & 0x0f);
+}
+
+TEST(charge_controller_keeps_its_step_across_deep_sleep)
+{
+    Rig rig([](Rig &rig, TestAXP192 &axp) {
+        axp.set_charge_controller(CURRENT_450MA, 0.5f, 4.5f, 70.0f);
+        axp.set_update_interval(15000);
+    });
+    usb_powered(rig);
+    rig.boot();
+    rig.run_for(10 * 60 * 1000);
+    CHECK_EQ(rig.pmic.reg(0x33) & 0x0f, CURRENT_450MA);
+
+    CHECK(rig.deep_sleep([&]() { rig.axp->DeepSleep(SLEEP_SEC(60)); }));
+    CHECK(rig.axp->fast_wake_);
+    CHECK_EQ(rig.axp->charge_step_, CURRENT_450MA);
+    rig.poll();
+    CHECK_EQ(rig.pmic.reg(0x33) & 0x0f, CURRENT_450MA);
+}
+
+TEST(charge_controller_holds_its_step_on_a_failed_status_read)
+{
+    Rig rig([](Rig &rig, TestAXP192 &axp) {
+        axp.set_charge_controller(CURRENT_450MA, 0.5f, 4.5f, 70.0f);
+        axp.set_update_interval(15000);
+    });
+    usb_powered(rig);
+    // Without the charge status nothing is raised
+    rig.pmic.fail_reads_at = 0x01;
+    rig.boot();
+    rig.run_for(2 * 60 * 1000);
+    CHECK_EQ(rig.axp->charge_step_, CURRENT_100MA);
+
+    rig.pmic.fail_reads_at = -1;
+    rig.run_for(10 * 60 * 1000);
+    CHECK_EQ(rig.axp->charge_step_, CURRENT_450MA);
+    // An unreadable power status is not an unplugged supply, the step stays
+    rig.pmic.fail_reads_at = 0x00;
+    rig.run_for(31000);
+    CHECK_EQ(rig.axp->charge_step_, CURRENT_450MA);
+    CHECK_EQ(rig.pmic.reg(0x33) & 0x0f, CURRENT_450MA);
+}
+
+//---------- Backlight ----------
+TEST(backlight_output_follows_the_lightness_curve)
+{
+    if (ModelTraits::BACKLIGHT_REG == 0)
+        return;
+    Rig rig;
+    TestAXP192 &axp = rig.boot();
+    AXP192Backlight backlight;
+    backlight.set_parent(&axp);
+    auto code = [&]() {
+        return (rig.pmic.reg(ModelTraits::BACKLIGHT_REG) & ModelTraits::BACKLIGHT_MASK) >> ModelTraits::BACKLIGHT_SHIFT;
+    };
+
+    // Applied on the write itself, without waiting for update()
+    rig.pmic.stats.reset();
+    backlight.set_level(1.0f);
+    CHECK_EQ(code(), ModelTraits::BACKLIGHT_MAX);
+    CHECK(rig.pmic.stats.writes <= 1);
+
+    int last = ModelTraits::BACKLIGHT_MIN;
+    for (int i = 0; i <= 20; i++)
+    {
+        backlight.set_level(i / 20.0f);
+        CHECK(code() >= last);
+        last = code();
+    }
+    // Half lightness is well below half the voltage range
+    backlight.set_level(0.5f);
+    CHECK(code() < (ModelTraits::BACKLIGHT_MIN + ModelTraits::BACKLIGHT_MAX) / 2);
+}
+
+//---------- Rails ----------
+TEST(rail_voltages_round_down_to_the_step)
+{
+    Rig rig;
+    TestAXP192 &axp = rig.boot();
+    axp.SetRailVoltage(RAIL_DCDC2, 1234);
+    CHECK_EQ(axp.GetRailVoltage(RAIL_DCDC2), 1225);
+    CHECK_EQ(rig.pmic.reg(0x23) & 0x3f, (1225 - 700) / 25);
+    axp.SetRailVoltage(RAIL_LDO3, 5000);
+    CHECK_EQ(axp.GetRailVoltage(RAIL_LDO3), 3300);
+
+    axp.SetRailEnabled(RAIL_LDOIO0, true);
+    CHECK_EQ(rig.pmic.reg(0x90) & 0x07, 0x02);
+    CHECK(axp.GetRailEnabled(RAIL_LDOIO0));
+    axp.SetRailEnabled(RAIL_LDOIO0, false);
+    CHECK(!axp.GetRailEnabled(RAIL_LDOIO0));
+}
+
+TEST(backlight_switches_its_rail_off_at_zero)
+{
+    if (ModelTraits::BACKLIGHT_REG == 0)
+        return;
+    Rig rig;
+    TestAXP192 &axp = rig.boot();
+    auto code = [&]() {
+        return (rig.pmic.reg(ModelTraits::BACKLIGHT_REG) & ModelTraits::BACKLIGHT_MASK) >> ModelTraits::BACKLIGHT_SHIFT;
+    };
+
+    axp.set_brightness(1.0f);
+    CHECK_EQ(code(), ModelTraits::BACKLIGHT_MAX);
+    CHECK(rig.pmic.reg(0x12) & ModelTraits::BACKLIGHT_RAIL);
+    axp.set_brightness(0.0f);
+    CHECK_EQ(code(), ModelTraits::BACKLIGHT_MIN);
+    CHECK(ModelTraits::BACKLIGHT_RAIL != 0);
+    CHECK_EQ(rig.pmic.reg(0x12) & ModelTraits::BACKLIGHT_RAIL, 0);
+    axp.set_brightness(0.6f);
+    CHECK(code() > ModelTraits::BACKLIGHT_MIN && code() < ModelTraits::BACKLIGHT_MAX);
+    CHECK(rig.pmic.reg(0x12) & ModelTraits::BACKLIGHT_RAIL);
+}
+
+TEST(rail_output_switches_off_at_zero)
+{
+    Rig rig;
+    TestAXP192 &axp = rig.boot();
+    AXP192RailOutput output;
+    output.set_parent(&axp);
+    output.set_rail(RAIL_DCDC2);
+    output.set_voltage_range(1.0f, 2.0f);
+    output.set_level(0.5f);
+    CHECK(axp.GetRailEnabled(RAIL_DCDC2));
+    CHECK_EQ(axp.GetRailVoltage(RAIL_DCDC2), 1500);
+    output.set_level(0.0f);
+    CHECK(!axp.GetRailEnabled(RAIL_DCDC2));
+}
+
+//---------- ADC duty cycle ----------
+TEST(duty_cycle_powers_the_adc_only_around_the_read)
+{
+    Rig rig([](Rig &rig, TestAXP192 &axp) {
+        axp.set_batteryvoltage_sensor(rig.sensor("battery_voltage"));
+        axp.set_adc_duty_cycle(true);
+    });
+    TestAXP192 &axp = rig.boot();
+    CHECK_EQ(rig.pmic.adc_enables(), axp.AdcIdleChannels());
+
+    // A result converted before the ADC went down must not be published
+    rig.pmic.inputs().bat_mv = 3712.0f;
+    sim::advance_ms(5000);
+    rig.poll();
+    CHECK_NEAR(rig.state("battery_voltage"), 3.712, 0.0011);
+    CHECK_EQ(rig.pmic.adc_enables(), axp.AdcIdleChannels());
+}
+
+// Settle time against accuracy: the battery voltage changes while the ADC is off, every update after that is
+// fresh or stale. The enable lands at a different point of the conversion cycle each time, so the first result
+// takes one to two sample periods. Set SIM_TABLES to print the sweep.
+struct SettleResult
+{
+    unsigned stale;
+    unsigned reads;
+    double worst_error_mv;
+};
+
+static SettleResult settle_sweep(AXP192AdcRate rate, uint32_t settle_ms, unsigned phases)
+{
+    Rig rig([rate, settle_ms](Rig &rig, TestAXP192 &axp) {
+        axp.set_batteryvoltage_sensor(rig.sensor("battery_voltage"));
+        axp.set_adc_duty_cycle(true, settle_ms);
+        axp.adc_rate_ = rate;
+    });
+    rig.loop_period_us = 250;
+    rig.boot();
+    rig.poll();
+
+    uint64_t period_us = 1000000u / (25u << rate);
+    SettleResult result{0, 0, 0.0};
+    for (unsigned phase = 0; phase < phases; phase++)
+    {
+        rig.pmic.first_conversion_delay_us = period_us * phase / phases;
+        float truth = 3700.0f + 20.0f * phase;
+        rig.pmic.inputs().bat_mv = truth;
+        sim::advance_ms(5000);
+        rig.poll();
+        double error = fabs(rig.state("battery_voltage") * 1000.0 - truth);
+        result.reads++;
+        if (error > 2.0)
+            result.stale++;
+        result.worst_error_mv = std::max(result.worst_error_mv, error);
+    }
+    return result;
+}
+
+TEST(duty_cycle_settle_time_against_accuracy)
+{
+    const unsigned PHASES = 8;
+    bool print = getenv("SIM_TABLES") != nullptr;
+    if (print)
+        printf("%s: rate_hz,settle_ms,settle_periods,stale,reads,worst_error_mv\n", ModelTraits::NAME);
+    for (uint8_t rate = ADC_RATE_25HZ; rate <= ADC_RATE_200HZ; rate++)
+    {
+        uint32_t period_ms = 1000u / (25u << rate);
+        // 1ms stands in for no settle time, 0 selects the default
+        const uint32_t settles[] = {1, period_ms / 2, period_ms, period_ms * 3 / 2, period_ms * 2};
+        unsigned last_stale = PHASES;
+        for (uint32_t settle_ms : settles)
+        {
+            SettleResult result = settle_sweep(static_cast<AXP192AdcRate>(rate), settle_ms, PHASES);
+            if (print)
+                printf("%s: %u,%u,%.2f,%u,%u,%.1f\n", ModelTraits::NAME, 25u << rate, (unsigned) settle_ms,
+                       (double) settle_ms / period_ms, result.stale, result.reads, result.worst_error_mv);
+            // A longer settle time never reads more stale results
+            CHECK(result.stale <= last_stale);
+            last_stale = result.stale;
+            if (settle_ms < period_ms)
+                CHECK_EQ(result.stale, PHASES);
+        }
+        // The default, two periods, is fresh wherever the enable lands
+        CHECK_EQ(last_stale, 0);
+        CHECK_EQ(settle_sweep(static_cast<AXP192AdcRate>(rate), 0, PHASES).stale, 0);
+    }
+}
+
+//---------- Low battery shutdown ----------
+TEST(low_battery_shutdown_powers_off_and_reports_next_boot)
+{
+    Rig rig([](Rig &rig, TestAXP192 &axp) {
+        axp.set_irq_pin(&rig.irq_pin);
+        axp.set_low_battery_shutdown(3.45f, 3.3f, 1000, 2000, false);
+    });
+    rig.boot();
+    rig.pmic.inputs().aps_mv = 3250.0f;
+    rig.loop_once();
+    CHECK(rig.pmic.powered_off());
+    CHECK_EQ(rig.pmic.reg(0x06), 0xA1);
+    CHECK_EQ(App.safe_shutdown_hooks_run, 1);
+
+    rig.pmic.power_key();
+    rig.pmic.inputs().aps_mv = 3900.0f;
+    sim::log_clear();
+    rig.boot();
+    CHECK(sim::log_contains("Last low battery shutdown"));
+    CHECK_EQ(rig.pmic.reg(0x06), 0x00);
+}
+
+TEST(low_battery_is_polled_without_an_irq_line)
+{
+    Rig rig([](Rig &rig, TestAXP192 &axp) { axp.set_low_battery_shutdown(3.45f, 3.3f, 500, 2000, false); });
+    rig.boot();
+    rig.run_for(1000);
+    rig.pmic.inputs().aps_mv = 3250.0f;
+    rig.run_for(600);
+    CHECK(rig.pmic.powered_off());
+}
+
+TEST(shutdown_automation_gets_its_deadline)
+{
+    unsigned calls = 0;
+    Rig rig([&calls](Rig &rig, TestAXP192 &axp) {
+        axp.set_irq_pin(&rig.irq_pin);
+        axp.set_low_battery_shutdown(3.45f, 3.3f, 1000, 2000, false);
+        axp.add_on_low_battery_shutdown_callback([&calls]() { calls++; });
+    });
+    rig.boot();
+    rig.pmic.inputs().aps_mv = 3250.0f;
+    rig.run_for(1900);
+    CHECK_EQ(calls, 1);
+    CHECK(!rig.pmic.powered_off());
+    rig.run_for(200);
+    CHECK(rig.pmic.powered_off());
+}
+
+//---------- Model traits ----------
+TEST(begin_follows_the_model_traits)
+{
+    Rig rig;
+    rig.boot();
+    CHECK_EQ(rig.pmic.reg(0x12) & ModelTraits::DISABLED_RAILS, 0);
+    CHECK(rig.pmic.reg(0x12) & 0x01 || (ModelTraits::DISABLED_RAILS & 0x01));
+    CHECK_EQ(rig.pmic.reg(0x90), ModelTraits::DISABLE_RTC ? 0x07 : 0x02);
+}
+
+TEST(rails_settle_before_dependent_components_set_up)
+{
+    Rig rig;
+    TestAXP192 &axp = rig.boot();
+    // Ahead of the displays and touch controllers powered from these rails
+    CHECK(axp.get_setup_priority() > setup_priority::HARDWARE);
+    // Power on: setup() returns straight away, can_proceed() holds the next components back for the settle time
+    CHECK(rig.setup_ms < ModelTraits::RAIL_SETTLE_MS);
+    CHECK(esphome::millis() >= ModelTraits::RAIL_SETTLE_MS);
+    CHECK(axp.can_proceed());
+    CHECK(sim::log_contains("Rails up"));
+
+    // A soft restart finds the rails already up
+    rig.boot(ESP_RST_SW);
+    CHECK(esphome::millis() < ModelTraits::RAIL_SETTLE_MS);
+}
+
+//---------- Deep sleep fast wake ----------
+TEST(deep_sleep_wake_restores_only_the_sleep_delta)
+{
+    Rig rig([](Rig &rig, TestAXP192 &axp) { axp.set_batterylevel_sensor(rig.sensor("battery_level")); });
+    rig.boot();
+    uint8_t rails = rig.pmic.reg(0x12);
+    uint32_t protection_writes = rig.pmic.stats.register_writes[0x39];
+
+    CHECK(rig.deep_sleep([&]() { rig.axp->DeepSleep(SLEEP_SEC(30)); }));
+    CHECK(rig.axp->fast_wake_);
+    CHECK_EQ(rig.pmic.reg(0x12), rails);
+    // begin() did not run again
+    CHECK_EQ(rig.pmic.stats.register_writes[0x39], protection_writes);
+    rig.poll();
+    CHECK(sim::log_contains("(fast wake init)"));
+}
+
+TEST(fuel_gauge_counts_through_deep_sleep)
+{
+    Rig rig([](Rig &rig, TestAXP192 &axp) {
+        axp.set_batterylevel_sensor(rig.sensor("battery_level"));
+        axp.set_battery_capacity(1000.0f);
+        axp.add_sleep_profile("dark", 0, 0, 0, false, false, -1);
+    });
+    rig.pmic.inputs().bat_ma = -200.0f;
+    rig.boot();
+    rig.poll();
+
+    // 30 minutes at 200mA, with the default profile and with one that keeps no ADCs
+    for (const char *name : {"", "dark"})
+    {
+        float before = rig.axp->fuel_charge_mah_;
+        CHECK(rig.deep_sleep([&]() {
+            rig.axp->DeepSleep(SLEEP_SEC(30 * 60), *name ? rig.axp->find_sleep_profile(name) : nullptr);
+        }));
+        rig.poll();
+        CHECK_NEAR(before - rig.axp->fuel_charge_mah_, 100.0, 2.0);
+    }
+}
+
+TEST(fuel_gauge_warm_starts_at_a_raised_adc_rate)
+{
+    Rig rig([](Rig &rig, TestAXP192 &axp) {
+        axp.set_batterylevel_sensor(rig.sensor("battery_level"));
+        axp.set_battery_capacity(1000.0f);
+        axp.set_fast_sample_interval(10);
+    });
+    rig.pmic.inputs().bat_ma = -200.0f;
+    rig.boot();
+    CHECK(rig.pmic.adc_rate_hz() > 25);
+    rig.poll();
+
+    // Away from the OCV estimate, so a reseed would show
+    rig.axp->fuel_charge_mah_ = 700.0f;
+    CHECK(rig.deep_sleep([&]() { rig.axp->DeepSleep(SLEEP_SEC(30 * 60)); }));
+    CHECK(sim::log_contains("Fuel gauge restored"));
+    CHECK_EQ(rig.axp->adc_rate_, rig.pmic.reg(0x84) >> 6);
+    CHECK_NEAR(rig.axp->fuel_charge_mah_, 600.0, 2.0);
+}
+
+TEST(sleep_profile_irq_mask_is_put_back_on_wake)
+{
+    // Awake: the VBUS and button events; asleep: only VBUS insert, and 0x4A cleared
+    Rig rig([](Rig &rig, TestAXP192 &axp) {
+        axp.set_irq_pin(&rig.irq_pin);
+        axp.set_vbus_binary_sensor(rig.binary_sensor("vbus"));
+        axp.add_sleep_profile("usb", 0, 0, 0, false, true, -1, 0x0800000000LL);
+    });
+    rig.boot();
+    uint8_t awake[5];
+    const uint8_t regs[5] = {0x40, 0x41, 0x42, 0x43, 0x4A};
+    for (uint8_t i = 0; i < 5; i++)
+        awake[i] = rig.pmic.reg(regs[i]);
+    CHECK(awake[0] & (1 << 2));
+
+    rig.axp->LightSleep(SLEEP_SEC(1), rig.axp->find_sleep_profile("usb"));
+    for (uint8_t i = 0; i < 5; i++)
+        CHECK_EQ(rig.pmic.reg(regs[i]), awake[i]);
+
+    CHECK(rig.deep_sleep([&]() {
+        rig.axp->DeepSleep(SLEEP_SEC(60), rig.axp->find_sleep_profile("usb"));
+        }));
+    for (uint8_t i = 0; i < 5; i++)
+        CHECK_EQ(rig.pmic.reg(regs[i]), awake[i]);
+}
+
+TEST(sleep_profile_irq_mask_applies_while_asleep)
+{
+    Rig rig([](Rig &rig, TestAXP192 &axp) {
+        axp.set_irq_pin(&rig.irq_pin);
+        axp.set_vbus_binary_sensor(rig.binary_sensor("vbus"));
+        axp.add_sleep_profile("usb", 0, 0, 0, false, true, -1, 0x0800000000LL);
+    });
+    TestAXP192 &axp = rig.boot();
+    axp.SetSleep(axp.find_sleep_profile("usb"));
+    CHECK_EQ(rig.pmic.reg(0x40), 0x08);
+    CHECK_EQ(rig.pmic.reg(0x41), 0x00);
+    CHECK_EQ(rig.pmic.reg(0x42), 0x00);
+    CHECK_EQ(rig.pmic.reg(0x43), 0x00);
+    CHECK_EQ(rig.pmic.reg(0x4A), 0x00);
+}
+
+TEST(changed_configuration_runs_a_full_init_after_sleep)
+{
+    AXP192ChargeCurrent current = CURRENT_100MA;
+    Rig rig([&current](Rig &rig, TestAXP192 &axp) { axp.set_charge_current(current); });
+    rig.boot();
+    current = CURRENT_360MA;
+    CHECK(rig.deep_sleep([&]() { rig.axp->DeepSleep(SLEEP_SEC(30)); }));
+    CHECK(!rig.axp->fast_wake_);
+    CHECK_EQ(rig.pmic.reg(0x33) & 0x07, CURRENT_360MA);
+}
+
+TEST(registers_changed_during_sleep_run_a_full_init)
+{
+    Rig rig;
+    rig.boot();
+    CHECK(rig.deep_sleep([&]() {
+        rig.axp->DeepSleep(SLEEP_SEC(30));
+    }));
+    CHECK(rig.axp->fast_wake_);
+    CHECK(rig.deep_sleep([&]() {
+        try
+        {
+            rig.axp->DeepSleep(SLEEP_SEC(30));
+        }
+        catch (const sim::DeepSleep &)
+        {
+            // Something else wrote a sleep register while the ESP was down
+            rig.pmic.set_reg(0x33, rig.pmic.reg(0x33) ^ 0x01);
+            throw;
+        }
+    }));
+    CHECK(!rig.axp->fast_wake_);
+}
+
+TEST(light_sleep_puts_the_registers_back)
+{
+    Rig rig;
+    TestAXP192 &axp = rig.boot();
+    uint8_t rails = rig.pmic.reg(0x12);
+    uint8_t adc = rig.pmic.reg(0x82);
+    axp.LightSleep(SLEEP_SEC(5));
+    CHECK_EQ(sim::light_sleeps, 1);
+    CHECK_EQ(rig.pmic.reg(0x12), rails);
+    CHECK_EQ(rig.pmic.reg(0x82), adc);
+}
+
+//---------- Events ----------
+TEST(irq_line_drives_the_binary_sensors)
+{
+    Rig rig([](Rig &rig, TestAXP192 &axp) {
+        axp.set_irq_pin(&rig.irq_pin);
+        axp.set_vbus_binary_sensor(rig.binary_sensor("vbus"));
+        axp.set_button_binary_sensor(rig.binary_sensor("button"));
+    });
+    rig.boot();
+    CHECK(!rig.binary_sensor("vbus")->state);
+
+    rig.pmic.stats.reset();
+    usb_powered(rig);
+    rig.loop_once();
+    CHECK(rig.binary_sensor("vbus")->state);
+    // Status read and acknowledge, nothing else
+    CHECK_EQ(rig.pmic.stats.transactions, 2);
+    CHECK(!rig.pmic.irq_asserted());
+
+    rig.pmic.press_button(false);
+    rig.loop_once();
+    auto &history = rig.binary_sensor("button")->history;
+    CHECK(history.size() >= 2 && history[history.size() - 2] && !history.back());
+}
+
+TEST(events_are_polled_without_an_irq_line)
+{
+    unsigned charge_start = 0, charge_done = 0;
+    Rig rig([&charge_start, &charge_done](Rig &rig, TestAXP192 &axp) {
+        axp.add_on_event_callback(EVENT_CHARGE_START, [&charge_start]() { charge_start++; });
+        axp.add_on_event_callback(EVENT_CHARGE_DONE, [&charge_done]() { charge_done++; });
+    });
+    usb_powered(rig);
+    rig.boot();
+    rig.pmic.inputs().charging = false;
+    rig.poll();
+    CHECK_EQ(charge_done, 1);
+    rig.pmic.inputs().charging = true;
+    rig.poll();
+    CHECK_EQ(charge_start, 1);
+}
+
+TEST(binary_sensors_wait_for_a_readable_status)
+{
+    Rig rig([](Rig &rig, TestAXP192 &axp) {
+        axp.set_vbus_binary_sensor(rig.binary_sensor("vbus"));
+        axp.set_charging_binary_sensor(rig.binary_sensor("charging"));
+    });
+    usb_powered(rig);
+    rig.pmic.fail_reads_at = 0x00;
+    rig.boot();
+    // No state rather than a false "unplugged"
+    CHECK(rig.binary_sensor("vbus")->history.empty());
+    CHECK(rig.binary_sensor("charging")->state);
+}
+
+//---------- Energy ----------
+TEST(energy_integrates_vin_power)
+{
+    Rig rig([](Rig &rig, TestAXP192 &axp) { axp.set_energy_sensor(ENERGY_VIN, rig.sensor("vin_energy")); });
+    sim::AXP192Inputs &in = rig.pmic.inputs();
+    in.vin_mv = 5000.0f;
+    in.vin_ma = 200.0f;
+    rig.boot();
+    rig.run_for(3600 * 1000 + 1000);
+    CHECK_NEAR(rig.state("vin_energy"), 1.0, 0.02);
+}
+
+TEST(energy_totals_survive_power_loss)
+{
+    Rig rig([](Rig &rig, TestAXP192 &axp) {
+        axp.set_energy_sensor(ENERGY_VIN, rig.sensor("vin_energy"));
+        axp.set_energy_commit_interval(600000);
+    });
+    sim::AXP192Inputs &in = rig.pmic.inputs();
+    in.vin_mv = 5000.0f;
+    in.vin_ma = 200.0f;
+    rig.boot();
+    // The published total right after the second commit is what flash holds
+    while (sim::flash_writes < 2 && sim::world_us < 3600ULL * 1000000)
+        rig.run_for(1000);
+    float before = rig.state("vin_energy");
+    // Two commits, each once 10 minutes of updates have accumulated
+    CHECK(before >= 1.0 / 3 && before < 0.4);
+
+    lose_rtc_memory();
+    rig.pmic.power_on();
+    rig.pmic.inputs().vin_mv = 0.0f;
+    rig.boot();
+    rig.poll();
+    CHECK_NEAR(rig.state("vin_energy"), before, 0.001);
+}
+
+//---------- Fuel gauge ----------
+TEST(fuel_gauge_counts_down_from_the_ocv_seed)
+{
+    Rig rig([](Rig &rig, TestAXP192 &axp) {
+        axp.set_batterylevel_sensor(rig.sensor("battery_level"));
+        axp.set_battery_capacity(1000.0f);
+    });
+    // 3870mV is 60% on the OCV table
+    rig.pmic.inputs().bat_mv = 3870.0f;
+    rig.pmic.inputs().bat_ma = -500.0f;
+    rig.boot();
+    CHECK(rig.axp->fuel_gauge_ready_);
+    CHECK_NEAR(rig.axp->fuel_charge_mah_, 600.0, 1.0);
+    rig.run_for(30 * 60 * 1000);
+    // 250mAh out
+    CHECK_NEAR(rig.state("battery_level"), 35.0, 1.0);
+}
+
+TEST(unreadable_battery_voltage_never_reads_as_full)
+{
+    auto configure = [](Rig &rig, TestAXP192 &axp) {
+        axp.set_batterylevel_sensor(rig.sensor("battery_level"));
+        axp.set_battery_capacity(1000.0f);
+    };
+
+    // No seed without a voltage
+    Rig cold(configure);
+    cold.pmic.fail_reads_at = 0x78;
+    cold.boot();
+    CHECK(!cold.axp->fuel_gauge_ready_);
+
+    // No OCV correction from a missing voltage while resting
+    Rig rig(configure);
+    rig.pmic.inputs().bat_mv = 3800.0f;
+    rig.pmic.inputs().bat_ma = 0.0f;
+    rig.boot();
+    rig.poll();
+    float seeded = rig.axp->fuel_charge_mah_;
+    CHECK(seeded < 500.0f);
+    rig.pmic.fail_reads_at = 0x78;
+    rig.run_for(10 * 60 * 1000);
+    CHECK_NEAR(rig.axp->fuel_charge_mah_, seeded, 1.0);
+}
+
+TEST(ocv_table_lookup)
+{
+    CHECK_NEAR(TestAXP192::OcvToSoc(3.0f), 0.0, 0.0);
+    CHECK_NEAR(TestAXP192::OcvToSoc(3.87f), 60.0, 0.01);
+    CHECK_NEAR(TestAXP192::OcvToSoc(4.3f), 100.0, 0.0);
+}
+
+//---------- History and trace ----------
+#ifdef AXP192_HISTORY_BLOCKS
+TEST(history_dump_streams_one_block_per_loop)
+{
+    Rig rig([](Rig &rig, TestAXP192 &axp) { axp.set_history_interval(60000); });
+    TestAXP192 &axp = rig.boot();
+    rig.run_for(30 * 60 * 1000);
+    sim::log_clear();
+    axp.DumpHistory();
+    for (unsigned i = 0; i < AXP192_HISTORY_BLOCKS; i++)
+        rig.loop_once();
+    CHECK(sim::log_count("HIST ") >= 2);
+    CHECK(sim::log_contains("HIST end"));
+}
+
+// Decodes the dump as tools/axp192_history.py documents the block format
+TEST(history_blocks_decode_to_the_logged_samples)
+{
+    Rig rig([](Rig &rig, TestAXP192 &axp) { axp.set_history_interval(60000); });
+    rig.pmic.inputs().bat_mv = 4000.0f;
+    TestAXP192 &axp = rig.boot();
+    // 20 samples falling 5mV each, then a jump too large for a delta
+    for (int i = 0; i < 20; i++)
+    {
+        rig.run_for(60000);
+        rig.pmic.inputs().bat_mv -= 5.0f;
+    }
+    rig.pmic.inputs().bat_mv = 3600.0f;
+    rig.run_for(120000);
+    sim::log_clear();
+    axp.DumpHistory();
+    for (unsigned i = 0; i < AXP192_HISTORY_BLOCKS; i++)
+        rig.loop_once();
+
+    std::vector<int> battery_mv;
+    for (const std::string &line : sim::log_lines)
+    {
+        size_t at = line.find("HIST ");
+        unsigned n;
+        char hex[129];
+        if (at == std::string::npos || sscanf(line.c_str() + at, "HIST %u %128s", &n, hex) != 2 || strlen(hex) != 128)
+            continue;
+        uint8_t block[64];
+        for (int i = 0; i < 64; i++)
+            sscanf(&hex[2 * i], "%2hhx", &block[i]);
+        CHECK_EQ(block[0], 0xA1);
+        CHECK_EQ(block[2] | (block[3] << 8), 60);
+        // Sequence numbers carry on from the previous block
+        CHECK_EQ((size_t) (block[4] | (block[5] << 8)), battery_mv.size());
+        int mv = (int16_t) (block[8] | (block[9] << 8));
+        for (int i = 0; i < block[1]; i++)
+        {
+            if (i > 0)
+                mv += (int8_t) block[14 + (i - 1) * 3];
+            battery_mv.push_back(mv);
+        }
+    }
+    // 17 samples fill a block, the jump to 3600mV starts another
+    CHECK(battery_mv.size() >= 21);
+    CHECK(std::abs(battery_mv.front() - 4000) <= 1);
+    // The updates drift against the 60s steps, so a sample can see two of them
+    for (size_t i = 1; i + 2 < battery_mv.size(); i++)
+        CHECK(battery_mv[i] <= battery_mv[i - 1] && battery_mv[i] >= battery_mv[i - 1] - 11);
+    CHECK(std::abs(battery_mv.back() - 3600) <= 1);
+}
+#endif
+
+#ifdef AXP192_TRACE_RECORDS
+TEST(trace_records_reads_and_steps)
+{
+    Rig rig(all_channels);
+    TestAXP192 &axp = rig.boot();
+    uint32_t before = axp.trace_total_;
+    rig.poll();
+    CHECK(axp.trace_total_ > before);
+    sim::log_clear();
+    axp.DumpTrace();
+    for (unsigned i = 0; i <= AXP192_TRACE_RECORDS / 8; i++)
+        rig.loop_once();
+    CHECK(sim::log_contains("TRACE end"));
+    CHECK(sim::log_contains(" read "));
+    CHECK(sim::log_contains(" step "));
+}
+#endif
+
+int main(int argc, char **argv) { return test::run(argc, argv, ModelTraits::NAME); }
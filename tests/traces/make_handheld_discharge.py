@@ -0,0 +1,52 @@
+#!/usr/bin/env python3
+"""Generate handheld_discharge.csv, the synthetic trace replayed by the time_to_empty host test.
+
+A 1000mAh handheld on a 10 second grid: idle at 70mA with the display on at 220mA for two
+minutes in every ten, a radio burst at 300mA every five minutes, USB plugged in from 90 to
+120 minutes with 350mA of charge current, then running until the battery is flat. The
+battery voltage follows the component's OCV table minus 0.15 ohm of internal resistance.
+
+This is not a recording of a real device. It stands in for one until a logged trace exists.
+"""
+
+import random
+
+OCV_TABLE = [3270, 3610, 3690, 3710, 3730, 3750, 3770, 3790, 3800, 3820, 3840,
+             3850, 3870, 3910, 3950, 3980, 4020, 4080, 4110, 4150, 4200]
+CAPACITY_MAH = 1000.0
+STEP_S = 10
+PLUG_S = 90 * 60
+UNPLUG_S = 120 * 60
+
+
+def ocv(soc):
+    pos = max(0.0, min(1.0, soc)) * (len(OCV_TABLE) - 1)
+    i = min(int(pos), len(OCV_TABLE) - 2)
+    return OCV_TABLE[i] + (pos - i) * (OCV_TABLE[i + 1] - OCV_TABLE[i])
+
+
+def main():
+    rng = random.Random(192)
+    charge = 0.85 * CAPACITY_MAH
+    t = 0
+    print("# synthetic handheld trace, see make_handheld_discharge.py")
+    print("time_s,battery_ma,battery_mv,vbus")
+    while charge > 0.0:
+        vbus = PLUG_S <= t < UNPLUG_S
+        if vbus:
+            ma = 350.0 if charge < 0.95 * CAPACITY_MAH else 60.0
+        else:
+            ma = -70.0
+            if t % 600 < 120:
+                ma = -220.0
+            if t % 300 < STEP_S:
+                ma = -300.0
+            ma -= rng.uniform(0.0, 10.0)
+        mv = ocv(charge / CAPACITY_MAH) + 0.15 * ma
+        print("%d,%.0f,%.0f,%d" % (t, ma, mv, 1 if vbus else 0))
+        charge += ma * STEP_S / 3600.0
+        t += STEP_S
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+"""Decode the axp192 battery history log.
+
+Feed it the device log containing the lines written by the axp192.dump_history
+action ("HIST <n> <hex>"), or a raw dump of the RTC blocks with --binary. Prints
+one CSV row per sample, oldest first.
+
+Block format (64 bytes, little endian):
+  0      magic 0xA1
+  1      number of samples in the block (1..17)
+  2..3   sample interval in seconds
+  4..7   sequence number of the first sample, counting from the start of the log
+  8..9   battery voltage in mV
+  10..11 VBUS voltage in mV
+  12..13 AXP192 temperature in 0.1 degC (signed)
+  14..   one 3 byte record per further sample: signed deltas of the three values above
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+BLOCK_SIZE = 64
+HEADER_SIZE = 14
+RECORD_SIZE = 3
+MAGIC = 0xA1
+
+LINE = re.compile(r"HIST (\d+) ([0-9A-Fa-f]{%d})" % (2 * BLOCK_SIZE))
+
+
+def decode_block(block):
+    """Yield (sequence, interval_s, battery_mv, vbus_mv, temperature_c) for every sample in a block."""
+    if len(block) != BLOCK_SIZE or block[0] != MAGIC:
+        return
+    count = block[1]
+    if not 1 <= count <= 1 + (BLOCK_SIZE - HEADER_SIZE) // RECORD_SIZE:
+        raise ValueError(f"bad sample count {count}")
+    interval, sequence, battery, vbus, temperature = struct.unpack_from("<HIhhh", block, 2)
+    values = [battery, vbus, temperature]
+    for n in range(count):
+        if n > 0:
+            record = struct.unpack_from("<bbb", block, HEADER_SIZE + (n - 1) * RECORD_SIZE)
+            values = [v + d for v, d in zip(values, record)]
+        yield sequence + n, interval, values[0], values[1], values[2] / 10.0
+
+
+def read_log(stream):
+    blocks = []
+    for line in stream:
+        match = LINE.search(line)
+        if match:
+            blocks.append(bytes.fromhex(match.group(2)))
+    return blocks
+
+
+def read_binary(stream):
+    data = stream.read()
+    return [data[i:i + BLOCK_SIZE] for i in range(0, len(data) - BLOCK_SIZE + 1, BLOCK_SIZE)]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("file", nargs="?", help="log file, stdin when omitted")
+    parser.add_argument("--binary", action="store_true", help="input is raw 64 byte blocks")
+    args = parser.parse_args()
+
+    mode = "rb" if args.binary else "r"
+    with (open(args.file, mode) if args.file else (sys.stdin.buffer if args.binary else sys.stdin)) as stream:
+        blocks = read_binary(stream) if args.binary else read_log(stream)
+
+    samples = sorted(sample for block in blocks for sample in decode_block(block))
+    if not samples:
+        print("no history samples found", file=sys.stderr)
+        return 1
+
+    # Times are relative to the newest sample, the device has no wall clock for them
+    last = samples[-1][0]
+    print("sequence,seconds_before_last,battery_voltage,vbus_voltage,temperature")
+    for sequence, interval, battery, vbus, temperature in samples:
+        print(f"{sequence},{(last - sequence) * interval},{battery / 1000:.3f},{vbus / 1000:.3f},{temperature:.1f}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())